@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace cfg
 {
@@ -31,9 +32,13 @@ namespace cfg
     void addPathToFilter(const uint64_t& tid, const std::string& _p);
 
     extern std::unordered_map<std::string, bool> config;
-    extern std::vector<uint64_t> blacklist;
-    extern std::vector<uint64_t> favorites;
+    extern std::unordered_set<uint64_t> blacklist;
+    extern std::unordered_set<uint64_t> favorites;
     extern uint8_t sortType;
+    //0 = no limit
+    extern unsigned trashMaxSizeMB, trashMaxAgeDays;
+    //Remote transfers running at once and total speed cap in KB/s (0 = no limit)
+    extern unsigned remoteMaxTransfers, remoteMaxKBps;
     extern std::string driveClientID, driveClientSecret, driveRefreshToken;
     extern std::string webdavOrigin, webdavBasePath, webdavUser, webdavPassword;
 }
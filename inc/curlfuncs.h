@@ -2,6 +2,8 @@
 
 #include <string>
 #include <vector>
+#include <atomic>
+#include <curl/curl.h>
 
 #define HEADER_ERROR "ERROR"
 
@@ -16,8 +18,10 @@ namespace curlFuncs
     typedef struct
     {
         std::string path;
-        unsigned int size;
+        uint64_t size;
         uint64_t *o;
+        //Remote file is gzipped. It's unpacked to path after it's been checked
+        bool gunzip = false;
     } curlDlArgs;
 
     size_t writeDataString(const char *buff, size_t sz, size_t cnt, void *u);
@@ -29,6 +33,16 @@ namespace curlFuncs
 
     std::string getHeader(const std::string& _name, std::vector<std::string> *h);
 
+    //Handles share DNS and TLS sessions through one CURLSH. Open connections stay with the handle, or the multi handle it's added to.
+    //Borrow one for a request and return it after so its keep-alive connection gets reused instead of reconnecting every time
+    void poolInit();
+    void poolExit();
+    CURL *borrowHandle();
+    void returnHandle(CURL *handle);
+
+    //Requests on handles the calling thread borrows after this are aborted once *_cancel is true. NULL turns it off again
+    void setThreadCancelFlag(const std::atomic<bool> *_cancel);
+
     //Shortcuts/legacy
     std::string getJSONURL(std::vector<std::string> *headers, const std::string& url);
     bool getBinURL(std::vector<uint8_t> *out, const std::string& url);
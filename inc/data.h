@@ -19,15 +19,44 @@ namespace data
     bool loadUsersTitles(bool clearUsers);
     void sortUserTitles();
 
+    //Cheaper than loadUsersTitles when only one title or save changed. Only users whose list changed are touched.
+    //These return the indexes of those users.
+    //Reads every save tid has again. Falls back to a full reload if one needs a user that doesn't exist yet.
+    std::vector<unsigned> reloadTitleSaves(const uint64_t& tid);
+    std::vector<unsigned> removeTitleSaves(const uint64_t& tid);
+    //For a save that was just deleted
+    std::vector<unsigned> removeSave(const uint64_t& saveID);
+
     //Draws some stats to the upper left corner
     void dispStats();
 
+    //Called once per frame. Turns icons the loader finished into textures, frees the ones not drawn lately
+    //and applies play stats fetched in the background.
+    void update();
+
+    //The parts of a title's NACP JKSV uses. Names match NacpStruct's. The full one is 16KB a title
+    typedef struct
+    {
+        uint64_t save_data_owner_id;
+        int64_t user_account_save_data_size, user_account_save_data_journal_size, user_account_save_data_journal_size_max;
+        int64_t device_save_data_size, device_save_data_journal_size, device_save_data_journal_size_max;
+        int64_t bcat_delivery_cache_storage_size;
+        int64_t cache_storage_size, cache_storage_journal_size, cache_storage_data_and_journal_size_max;
+    } titleNacp;
+
     //Global stuff for all titles/saves
     typedef struct
     {
-        NacpStruct nacp;
+        titleNacp nacp;
         std::string title, safeTitle, author;//Shortcuts sorta.
+        //Made once from title when it's loaded so sorting doesn't decode it every compare
+        std::u32string sortKey;
+        //Loaded the first time it's drawn and freed again when it hasn't been for a while. Use getTitleIconByTID instead.
         SDL_Texture *icon = NULL;
+        //Where the icon's JPEG is in the title cache. -1 if it isn't cached
+        long iconOffset = -1;
+        //Imported SVIs keep their icon in memory
+        std::vector<uint8_t> iconJpeg;
         bool fav;
     } titleInfo;
 
@@ -96,6 +125,7 @@ namespace data
     //More shortcut functions
     std::string getTitleNameByTID(const uint64_t& tid);
     std::string getTitleSafeNameByTID(const uint64_t& tid);
+    //Returns a placeholder until the icon has been loaded. Don't keep it between frames.
     SDL_Texture *getTitleIconByTID(const uint64_t& tid);
     int getTitleIndexInUser(const data::user& u, const uint64_t& tid);
     extern SetLanguage sysLang;
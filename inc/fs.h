@@ -9,6 +9,8 @@
 #include "fs/zip.h"
 #include "fs/fsfile.h"
 #include "fs/remote.h"
+#include "fs/chunk.h"
+#include "fs/remotequeue.h"
 #include "ui/miscui.h"
 
 #define BUFF_SIZE 0x4000
@@ -47,6 +49,11 @@ namespace fs
     void restoreBackup(void *a);
     void deleteBackup(void *a);
 
+    //Runs in the background and removes the oldest entries from _TRASH_ until it fits the limits set in config
+    void trashPurgeThreaded();
+    //Deletes everything in _TRASH_. Safe to call while a purge is running
+    void trashEmpty();
+
     void dumpAllUserSaves(void *a);
     void dumpAllUsersAllSaves(void *a);
 
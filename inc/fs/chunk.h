@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+
+#include "../rfs.h"
+#include "type.h"
+
+//Chunks are kept in this folder under JKSV_DRIVE_FOLDER, named by their SHA-256
+#define JKSV_CHUNK_FOLDER "_chunks"
+//Added to the backup's name for the manifest uploaded in its place
+#define CHUNK_MANIFEST_EXT ".jksvchunks"
+
+namespace fs
+{
+    //Splits _localPath into content-defined chunks, uploads the ones the remote doesn't have and then a manifest named _filename + CHUNK_MANIFEST_EXT to _parent.
+    //A small change to a large backup only sends the chunks around it.
+    bool chunkUpload(const std::string& _localPath, const std::string& _filename, const std::string& _parent, threadInfo *t);
+    //Downloads the chunks listed in _manifest and puts them back together at _outPath. Every chunk and the full file are checked against their hash.
+    //Chunks are written out in order as they arrive, so the SD only needs room for a few MB of chunks on top of the file.
+    bool chunkDownload(const rfs::RfsItem& _manifest, const std::string& _outPath, threadInfo *t);
+    //Removes chunks no manifest on the remote uses anymore. Replaced or deleted backups leave these behind.
+    void chunkCollect();
+    inline bool isChunkManifest(const std::string& _name)
+    {
+        std::string ext = CHUNK_MANIFEST_EXT;
+        return _name.length() > ext.length() && _name.compare(_name.length() - ext.length(), ext.length(), ext) == 0;
+    }
+}
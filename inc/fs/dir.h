@@ -1,19 +1,23 @@
 #pragma once
 
 #include <string>
+#include <unordered_set>
 #include "type.h"
 
 namespace fs
 {
     void mkDir(const std::string& _p);
     void mkDirRec(const std::string& _p);
+    //Same, but skips anything already in _made and adds what it creates. For long runs of files going to the same few folders
+    void mkDirRec(const std::string& _p, std::unordered_set<std::string>& _made);
     void delDir(const std::string& _p);
     bool dirNotEmpty(const std::string& _dir);
     bool isDir(const std::string& _path);
 
     //threadInfo is optional. Only for updating task status.
     void copyDirToDir(const std::string& src, const std::string& dst, threadInfo *t);
-    void copyDirToDirThreaded(const std::string& src, const std::string& dst);
+    //_uploadPath is given to remoteQueueAdd after the copy finishes
+    void copyDirToDirThreaded(const std::string& src, const std::string& dst, uint64_t _uploadTID = 0, const std::string& _uploadPath = "");
     void copyDirToDirCommit(const std::string& src, const std::string& dst, const std::string& dev, threadInfo *t);
     void copyDirToDirCommitThreaded(const std::string& src, const std::string& dst, const std::string& dev);
     void getDirProps(const std::string& path, unsigned& dirCount, unsigned& fileCount, uint64_t& totalSize);
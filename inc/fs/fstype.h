@@ -14,6 +14,9 @@ namespace fs
         bool cleanup = false, trimZipPath = false;
         uint8_t trimZipPlaces = 0;
         uint64_t offset = 0;
+        //Queued for upload once the copy thread is done with it. Empty if it isn't
+        uint64_t uploadTID = 0;
+        std::string uploadPath;
         ui::progBar *prog;
         threadStatus *thrdStatus;
         Mutex arglck = 0;
@@ -18,4 +18,16 @@ namespace fs
 
     // Webdav
     void webDavInit();
+
+    // Path in the work dir for a temp file that's going to be uploaded. Never the same twice, so it can't clash with a backup or another upload
+    std::string remoteTmpPath(const std::string& _ext);
+    // Queues every backup in _titlePath for upload to _parent, skipping ones the remote already has an identical copy of.
+    // Folder backups are zipped to a remoteTmpPath first and the zip's path is added to _tmpZips to be deleted afterwards.
+    // Returns how many were skipped.
+    unsigned remoteQueueUploads(rfs::transferMngr& _transfers, const std::string& _titlePath, const std::string& _parent, std::vector<std::string>& _tmpZips, threadInfo *t);
+    // If remoteCompress is on and it's worth it, gzips _path to a remoteTmpPath, appends REMOTE_GZIP_EXT to _filename and returns the gzip's path.
+    // Otherwise _path is returned. Anything returned that isn't _path has to be deleted by the caller.
+    std::string remoteCompressUpload(const std::string& _path, std::string& _filename, threadInfo *t);
+    // Uploads what changed for every title of the current user
+    void remoteSyncAllTitles(void *a);
 }
\ No newline at end of file
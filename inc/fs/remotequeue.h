@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace fs
+{
+    //Backups waiting to be uploaded. Kept on SD so anything not sent survives a restart.
+    //A background thread uploads them one at a time whenever no foreground task is running.
+    void remoteQueueInit();
+    //Stops the upload in progress. It's picked up again on the next launch
+    void remoteQueueExit();
+    //_path is a backup file or folder (no trailing slash) of title _tid. Only added if autoUpload is on
+    void remoteQueueAdd(uint64_t _tid, const std::string& _path);
+    unsigned remoteQueueCount();
+    //Has the worker stop uploading _path, or anything in it if it's a folder, and waits for it to. The entry stays queued.
+    //Anything that changes or deletes a backup has to call this first
+    void remoteQueueRelease(const std::string& _path);
+    //Drops everything queued for _tid, stopping it if it's uploading
+    void remoteQueueRemoveTitle(uint64_t _tid);
+}
@@ -10,7 +10,8 @@ namespace fs
 {
     //threadInfo is optional and only used when threaded versions are used
     void copyDirToZip(const std::string& src, zipFile dst, bool trimPath, int trimPlaces, threadInfo *t);
-    void copyDirToZipThreaded(const std::string& src, zipFile dst, bool trimPath, int trimPlaces);
+    //_uploadPath is given to remoteQueueAdd after the zip is closed
+    void copyDirToZipThreaded(const std::string& src, zipFile dst, bool trimPath, int trimPlaces, uint64_t _uploadTID = 0, const std::string& _uploadPath = "");
     void copyZipToDir(unzFile src, const std::string& dst, const std::string& dev, threadInfo *t);
     void copyZipToDirThreaded(unzFile src, const std::string& dst, const std::string& dev);
     uint64_t getZipTotalSize(unzFile unz);
@@ -6,6 +6,9 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <time.h>
+#include <switch.h>
 
 #include "curlfuncs.h"
 #include "rfs.h"
@@ -20,6 +23,8 @@ namespace drive
     class gd : public rfs::IRemoteFS
     {
         public:
+            ~gd();
+
             void setClientID(const std::string& _clientID) { clientID = _clientID; }
             void setClientSecret(const std::string& _clientSecret) { secretID = _clientSecret; }
             void setRefreshToken(const std::string& _refreshToken) { rToken = _refreshToken; }
@@ -27,12 +32,18 @@ namespace drive
             bool exhangeAuthCode(const std::string& _authCode);
             bool hasToken() { return token.empty() == false; }
             bool refreshToken();
-            bool tokenIsValid();
+
+            //Keeps the access token fresh in the background so requests don't stall waiting on a refresh
+            void startTokenRefresh();
+            void stopTokenRefresh();
+            void tokenRefreshLoop();
             
-            void clearDriveList() { driveList.clear(); }
+            void clearDriveList();
             // TODO: This also gets files that do not belong to JKSV
             void driveListInit(const std::string& _q);
             void driveListAppend(const std::string& _q);
+            //Applies whatever changed on Drive since the last listing/update instead of listing everything again
+            void driveListUpdate();
             std::vector<rfs::RfsItem> getListWithParent(const std::string& _parent);
             void debugWriteList();
             
@@ -44,9 +55,13 @@ namespace drive
             bool fileExists(const std::string& _filename, const std::string& _parent);
             void uploadFile(const std::string& _filename, const std::string& _parent, curlFuncs::curlUpArgs *_upload);
             void updateFile(const std::string& _fileID, curlFuncs::curlUpArgs *_upload);
-            void downloadFile(const std::string& _fileID, curlFuncs::curlDlArgs *_download);
             void deleteFile(const std::string& _fileID);
 
+            bool prepareUpload(CURL *_curl, rfs::transferItem *_item);
+            bool prepareDownload(CURL *_curl, rfs::transferItem *_item);
+            void finishTransfer(CURL *_curl, rfs::transferItem *_item, bool _success);
+            std::string getChecksum(const std::string& _fileID);
+
             std::string getClientID() const { return clientID; }
             std::string getClientSecret() const { return secretID; }
             std::string getRefreshToken() const { return rToken; }
@@ -56,11 +71,44 @@ namespace drive
             std::string getDirID(const std::string& _name);
             std::string getDirID(const std::string& _name, const std::string& _parent);
 
-            size_t getDriveListCount() const { return driveList.size(); }
-            rfs::RfsItem *getItemAt(unsigned int _ind) { return &driveList[_ind]; }
+            size_t getDriveListCount() const { return driveItems.size(); }
 
         private:
-            std::vector<rfs::RfsItem> driveList;
+            void setToken(const std::string& _token, int _expiresIn);
+            //Returns the current token, refreshing first if it's about to expire
+            std::string getToken();
+            //Adds the auth header to _headers and performs. Retries once with a new token on 401
+            int performWithAuth(CURL *_curl, const std::vector<std::string>& _headers, std::string *_respOut, std::vector<std::string> *_headersOut);
+            int requestList(const std::string& _url, std::string *_respOut);
+            //Adds/updates the uploaded file in the list from Drive's response
+            void uploadFinish(const std::string& _json, const std::string& _parent, const std::string& _fileID, uint64_t _size);
+            //Returns nextPageToken if there is one
+            std::string processList(const std::string& _json);
+            void driveListFetch(const std::string& _q, const std::string& _function);
+            //driveListUpdate without the lock. Has to be called with syncLock held
+            void driveListSync();
+            void listItemAdd(const rfs::RfsItem& _item);
+            void listItemRemove(const std::string& _id);
+
+            //Items by ID, children by parent ID and IDs by parent/name
+            std::unordered_map<std::string, rfs::RfsItem> driveItems;
+            std::unordered_map<std::string, std::unordered_set<std::string>> driveChildren;
+            std::unordered_map<std::string, std::string> dirIndex, fileIndex;
+            std::string changesToken;
+            time_t lastSync = 0;
+            //Queries the list was built from. The changes feed can't filter, so these are listed again on update if any are set
+            std::vector<std::string> listQueries;
+            RMutex listLock = {0};
+            //Only one listing or update talks to Drive at a time. Guards changesToken, lastSync and listQueries
+            Mutex syncLock = 0;
             std::string clientID, secretID, token, rToken;
+            time_t tokenExpire = 0;
+            Mutex tokenLock = 0, refreshLock = 0;
+            CondVar refreshCond = 0;
+            //Set while a refresh is out. tokenCond wakes whoever was waiting on it. Guarded by tokenLock
+            CondVar tokenCond = 0;
+            bool tokenRefreshing = false, tokenRefreshed = false;
+            Thread refreshThread;
+            bool refreshRunning = false;
     };
 }
\ No newline at end of file
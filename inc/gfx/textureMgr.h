@@ -15,6 +15,11 @@ typedef enum
 
 namespace gfx
 {
+    //Only decodes. Doesn't touch the renderer so it's safe to call from any thread
+    SDL_Surface *surfaceLoadFromMem(imgTypes _type, const void *_dat, size_t _datSize);
+    //Same as above. Frees _surf and returns a _w x _h RGBA32 copy of it
+    SDL_Surface *surfaceResize(SDL_Surface *_surf, int _w, int _h);
+
     class textureMgr
     {
         public:
@@ -25,7 +30,11 @@ namespace gfx
             SDL_Texture *textureCreate(int _w, int _h);
             SDL_Texture *textureLoadFromFile(const char *_path);
             SDL_Texture *textureLoadFromMem(imgTypes _type, const void *_dat, size_t _datSize);
+            //Takes ownership of _surf and frees it
+            SDL_Texture *textureLoadFromSurface(SDL_Surface *_surf);
             void textureResize(SDL_Texture **_tex, int _w, int _h);
+            //Frees _tex now instead of at exit
+            void textureDestroy(SDL_Texture *_tex);
         
         private:
             std::vector<SDL_Texture *> textures;
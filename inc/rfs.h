@@ -2,11 +2,16 @@
 
 #include <string>
 #include "curlfuncs.h"
+#include "type.h"
 #include <mutex>
+#include <condition_variable>
 
 #define UPLOAD_BUFFER_SIZE 0x8000
-#define DOWNLOAD_BUFFER_SIZE 0xC00000
+// Each download has two of these
+#define DOWNLOAD_BUFFER_SIZE 0x400000
 #define USER_AGENT "JKSV"
+// Added to the name of backups that were gzipped for upload
+#define REMOTE_GZIP_EXT ".gz"
 
 namespace rfs {
 
@@ -14,9 +19,53 @@ namespace rfs {
     {
         std::string name, id, parent;
         bool isDir = false;
-        unsigned int size;
+        uint64_t size = 0;
+        // Lowercase hex SHA-256 if the backend reports one. Empty otherwise.
+        std::string checksum;
+        // WebDAV ETag. Changes whenever the remote file does.
+        std::string etag;
     } RfsItem;
 
+    typedef enum
+    {
+        TRANSFER_UPLOAD,
+        TRANSFER_DOWNLOAD
+    } transferTypes;
+
+    // One upload or download run by transferMngr
+    typedef struct
+    {
+        int type = TRANSFER_UPLOAD;
+        // Upload: name and parent to upload to. id is set if replacing an existing file.
+        // Download: id of the remote file.
+        std::string name, parent, id;
+        std::string localPath;
+        uint64_t size = 0, offset = 0;
+        bool finished = false, success = false;
+        // Download: SHA-256 the remote reports. Looked up before run() starts anything so finishing doesn't stall other transfers
+        std::string checksum;
+
+        // Upload: file the caller already has open to send instead of opening localPath. It's left open.
+        FILE *src = NULL;
+
+        // Used while running
+        FILE *f = NULL;
+        curl_slist *headers = NULL;
+        std::string response;
+        std::vector<std::string> respHeaders;
+
+        // Upload: part of the file the next request sends. It's the whole file unless prepareUpload narrows it.
+        uint64_t sendFrom = 0, sendTo = 0;
+        // Backends that upload in pieces keep their state here between requests. Drive keeps its session URL and how much it has
+        std::string session;
+        uint64_t committed = 0;
+        unsigned retries = 0;
+        bool query = false;
+        // Set by finishTransfer to have it prepared and started again instead of finishing. Not started again before retryAt (system tick)
+        bool again = false;
+        uint64_t retryAt = 0;
+    } transferItem;
+
     class IRemoteFS
     {
     public:
@@ -27,27 +76,103 @@ namespace rfs {
         virtual bool fileExists(const std::string& _filename, const std::string& _parent) = 0;
         virtual void uploadFile(const std::string& _filename, const std::string& _parent, curlFuncs::curlUpArgs *_upload) = 0;
         virtual void updateFile(const std::string& _fileID, curlFuncs::curlUpArgs *_upload) = 0;
-        virtual void downloadFile(const std::string& _fileID, curlFuncs::curlDlArgs *_download) = 0;
+        // Downloads to _download->path + ".part" and renames it when finished. A partial file left from a
+        // failed attempt is continued with a Range request. Size and checksum (if the backend has one) are checked at the end.
+        virtual bool downloadFile(const std::string& _fileID, curlFuncs::curlDlArgs *_download);
         virtual void deleteFile(const std::string& _fileID) = 0;
 
         virtual std::string getFileID(const std::string& _name, const std::string& _parent) = 0;
         virtual std::string getDirID(const std::string& _name, const std::string& _parent) = 0;
 
         virtual std::vector<RfsItem> getListWithParent(const std::string& _parent) = 0;
+
+        // Used by transferMngr. Sets _curl up for the transfer's next request without performing it. Nothing here should block.
+        // Data callbacks are set by the manager.
+        virtual bool prepareUpload(CURL *_curl, transferItem *_item) = 0;
+        virtual bool prepareDownload(CURL *_curl, transferItem *_item) = 0;
+        // Called when a transfer is done so the backend can update whatever it keeps track of.
+        // Backends that need more than one request per transfer set _item->again here to have it started again.
+        virtual void finishTransfer(CURL *_curl, transferItem *_item, bool _success) = 0;
+        // Lowercase hex SHA-256 of the remote file. Empty if the backend doesn't provide one.
+        virtual std::string getChecksum(const std::string& _fileID) { return ""; }
+        // True if the remote file has the same contents as _localPath so uploading it again can be skipped
+        bool remoteMatches(const std::string& _localPath, const std::string& _fileID);
+    };
+
+    // Runs queued uploads/downloads at the same time through curl_multi.
+    // _maxConcurrent caps how many run at once and _maxBytesPerSec (0 = no limit) is split between the ones running.
+    class transferMngr
+    {
+        public:
+            transferMngr(IRemoteFS *_rfs, unsigned _maxConcurrent, uint64_t _maxBytesPerSec);
+            ~transferMngr();
+
+            void addUpload(const std::string& _localPath, const std::string& _name, const std::string& _parent, const std::string& _fileID);
+            // Sends from _f, which the caller closes after run()
+            void addUpload(FILE *_f, const std::string& _name, const std::string& _parent, const std::string& _fileID);
+            void addDownload(const std::string& _fileID, const std::string& _name, const std::string& _localPath, uint64_t _size);
+
+            // Blocks until everything queued is finished or cancel() is called.
+            // If t is passed, status is updated with each running transfer and t->argPtr is treated as fs::copyArgs for total progress
+            void run(threadInfo *t);
+            void cancel() { canceled = true; }
+            // Shown above the transfer list in the status
+            void setStatusHeader(const std::string& _header) { statusHeader = _header; }
+
+            unsigned getCount() const { return transfers.size(); }
+            unsigned getFailedCount();
+            uint64_t getTotalSize();
+            uint64_t getTotalTransferred();
+            const transferItem *getItemAt(unsigned _ind) const { return transfers[_ind]; }
+
+        private:
+            CURL *start(CURLM *_multi, transferItem *_item);
+            // Returns true if the backend wants the transfer started again
+            bool finish(CURLM *_multi, CURL *_curl, CURLcode _res);
+            // Splits maxBytesPerSec evenly between _active. Called whenever one starts or finishes.
+            void setSpeedLimits(const std::vector<CURL *>& _active);
+            void updateStatus(threadInfo *t);
+
+            IRemoteFS *remote;
+            unsigned maxConcurrent;
+            uint64_t maxBytesPerSec;
+            bool canceled = false;
+            std::vector<transferItem *> transfers;
+            std::string statusHeader;
+            uint64_t startTick = 0;
     };
 
     // Shared multi-threading definitions
+    // Curl fills fillBuffer while the write thread writes out writeBuffer. When fillBuffer is full they're swapped.
+    // Both are allocated once up front so nothing is allocated or copied while downloading.
     typedef struct
     {
         curlFuncs::curlDlArgs *cfa;
         std::mutex dataLock;
         std::condition_variable cond;
-        std::vector<uint8_t> sharedBuffer;
-        bool bufferFull = false;
-        unsigned int downloaded = 0;
+        std::vector<uint8_t> fillBuffer, writeBuffer;
+        bool bufferFull = false, finished = false;
+        // Where in the file writing starts. Anything above 0 appends to what's already there
+        uint64_t offset = 0, downloaded = 0;
     } dlWriteThreadStruct;
 
-    extern std::vector<uint8_t> downloadBuffer;
+    void writeThreadInit(dlWriteThreadStruct *in, curlFuncs::curlDlArgs *_cfa, uint64_t _offset);
     void writeThread_t(void *a);
     size_t writeDataBufferThreaded(uint8_t *buff, size_t sz, size_t cnt, void *u);
+    // Hands whatever is left to the write thread and lets it exit. Must be called after the transfer, even if it failed
+    void writeThreadFinish(dlWriteThreadStruct *in);
+
+    // Lowercase hex SHA-256 of a local file
+    std::string fileSha256(const std::string& _path);
+    std::string sha256ToString(Sha256Context *_ctx);
+
+    // gzips _in to _out if a sample from the start of it shrinks enough to be worth the time. Returns false if it was skipped or failed.
+    bool gzipForUpload(const std::string& _in, const std::string& _out);
+    // Moves a finished download from _partPath to _path, unpacking it on the way if _gunzip is set
+    bool finishDownloadFile(const std::string& _partPath, const std::string& _path, bool _gunzip);
+    inline bool isRemoteGzip(const std::string& _name)
+    {
+        std::string ext = REMOTE_GZIP_EXT;
+        return _name.length() > ext.length() && _name.compare(_name.length() - ext.length(), ext.length(), ext) == 0;
+    }
 }
@@ -93,6 +93,10 @@ namespace ui
     int registerMenu(ui::menu *m);
     int registerPanel(ui::slideOutPanel *sop);
     threadInfo *newThread(ThreadFunc func, void *args, funcPtr _drawFunc);
+    //Low priority thread that runs alongside the UI. Only its status text is shown
+    threadInfo *newBackgroundThread(ThreadFunc func, void *args);
+    //True when no foreground task is running
+    bool foregroundIdle();
 
     //Just draws a screen and flips JIC boot takes long.
     void showLoadScreen();
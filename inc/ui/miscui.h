@@ -91,6 +91,7 @@ namespace ui
 
             //Resets selected + start
             void resetSel() { selected = 0; }
+            void setSelected(int _set) { selected = _set; }
 
             //Enables control/disables drawing select box
             void setActive(bool _set);
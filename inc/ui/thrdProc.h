@@ -10,15 +10,21 @@ namespace ui
             ~threadProcMngr();
             //Draw function is used and called to draw on overlay
             threadInfo *newThread(ThreadFunc func, void *args, funcPtr _drawFunc);
+            //Background threads start right away at low priority and don't block input. Only status text is drawn
+            threadInfo *newBackgroundThread(ThreadFunc func, void *args);
             void update();
+            void updateBackground();
             void draw();
-            bool empty() { return threads.empty(); }
+            void drawBackground();
+            //These lock, so background threads can check them too
+            bool empty();
+            bool backgroundEmpty();
 
         private:
-            std::vector<threadInfo *> threads;
+            std::vector<threadInfo *> threads, bgThreads;
             uint8_t lgFrame = 0, clrShft = 0;
             bool clrAdd = true;
             unsigned frameCount = 0;
-            Mutex threadLock = 0;
+            Mutex threadLock = 0, bgThreadLock = 0;
     };
 }
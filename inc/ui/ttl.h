@@ -1,11 +1,15 @@
 #pragma once
 
+#include <vector>
+
 namespace ui
 {
     void ttlInit();
     void ttlExit();
     void ttlSetActive(int usr, bool _set, bool _showSel);
     void ttlRefresh();
+    //Only the views of _users. Takes what data's incremental updates return
+    void ttlRefresh(const std::vector<unsigned>& _users);
 
     //JIC for func ptr
     void ttlReset();
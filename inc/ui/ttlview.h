@@ -10,22 +10,24 @@ namespace ui
     class titleTile
     {
         public:
-            titleTile(unsigned _w, unsigned _h, bool _fav, SDL_Texture *_icon)
+            titleTile(unsigned _w, unsigned _h, bool _fav, uint64_t _tid)
             {
                 w = _w;
                 h = _h;
                 wS = _w;
                 hS = _h;
                 fav = _fav;
-                icon = _icon;
+                tid = _tid;
             }
 
             void draw(SDL_Texture *target, int x, int y, bool sel);
+            uint64_t getTID() const { return tid; }
 
         private:
             unsigned w, h, wS, hS;
             bool fav = false;
-            SDL_Texture *icon;
+            //Icon is looked up every draw since it can be freed
+            uint64_t tid;
     };
 
     //Todo less hardcode etc
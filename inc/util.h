@@ -84,6 +84,8 @@ namespace util
     }
 
     std::string safeString(const std::string& s);
+    //Lowercased code points of s. Compared as is to sort by name
+    std::u32string getSortKey(const std::string& s);
 
     std::string getStringInput(SwkbdType _type, const std::string& def, const std::string& head, size_t maxLength, unsigned dictCnt, const std::string dictWords[]);
 
@@ -2,7 +2,7 @@
 
 #include <curl/curl.h>
 #include <string>
-#include <tinyxml2.h>
+#include <unordered_map>
 
 #include "rfs.h"
 
@@ -17,17 +17,46 @@ namespace rfs {
     // other string arguments never have any leading or trailing "/"
     class WebDav : public IRemoteFS {
     private:
-        CURL* curl;
         std::string origin;
         std::string basePath;
         std::string username;
         std::string password;
 
+        // WebDAV has no content hash, so the SHA-256 of each file JKSV uploads is kept with the ETag it got.
+        // If the ETag hasn't changed since, the file is still what was uploaded.
+        typedef struct {
+            std::string etag, sha256;
+        } uploadRecord;
+        std::unordered_map<std::string, uploadRecord> uploadRecords;
+        Mutex recordLock = 0;
+        void loadUploadRecords();
+        void saveUploadRecords();
+        void recordUpload(const std::string& id, const std::string& sha256);
 
-        std::vector<RfsItem> parseXMLResponse(const std::string& xml);
+        // Listings are kept per collection along with its ctag.
+        // Within LIST_CACHE_FRESH seconds they're used as is. After that a Depth 0 PROPFIND checks the ctag and the listing is only fetched again if it changed.
+        // A collection's etag doesn't have to change when its children do, so without a ctag the whole Depth 1 listing is fetched again instead.
+        typedef struct {
+            std::string version;
+            std::vector<RfsItem> items;
+            uint64_t checked;
+        } cachedListing;
+        std::unordered_map<std::string, cachedListing> listCache;
+        Mutex cacheLock = 0;
+        bool getListing(const std::string& parentId, std::vector<RfsItem>& items);
+        bool cachedListingHas(const std::string& parentId, const std::string& id, bool isDir);
+        // Has to be called after anything JKSV changes in a collection
+        void invalidateListing(const std::string& id);
+        bool sameResource(const std::string& idA, const std::string& idB);
+
+        void setupHandle(CURL* local_curl);
+        CURL* getHandle();
+        // Sends a PROPFIND with depth "0" or "1" and streams the response into items. Returns the HTTP status, 0 if the request failed.
+        // includeSelf keeps the first response, which is the resource the PROPFIND was sent to. version gets its ctag, empty if the server has none.
+        long propfind(const std::string& id, const char *depth, bool includeSelf, std::vector<RfsItem>& items, std::string *version = NULL);
+        std::string getEtag(const std::string& id);
         bool resourceExists(const std::string& id);
         std::string appendResourceToParentId(const std::string& resourceName, const std::string& parentId, bool isDir);
-        std::string getNamespacePrefix(tinyxml2::XMLElement* root, const std::string& nsURI);
 
     public:
         WebDav(const std::string& origin,
@@ -41,9 +70,13 @@ namespace rfs {
         bool fileExists(const std::string& filename, const std::string& parentId);
         void uploadFile(const std::string& filename, const std::string& parentId, curlFuncs::curlUpArgs *_upload);
         void updateFile(const std::string& fileID, curlFuncs::curlUpArgs *_upload);
-        void downloadFile(const std::string& fileID, curlFuncs::curlDlArgs *_download);
         void deleteFile(const std::string& fileID);
 
+        bool prepareUpload(CURL* local_curl, transferItem *item);
+        bool prepareDownload(CURL* local_curl, transferItem *item);
+        void finishTransfer(CURL* local_curl, transferItem *item, bool success);
+        std::string getChecksum(const std::string& fileID);
+
         std::string getFileID(const std::string& name, const std::string& parentId);
         std::string getDirID(const std::string& dirName, const std::string& parentId);
 
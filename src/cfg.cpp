@@ -1,5 +1,7 @@
 #include <switch.h>
 #include <string>
+#include <vector>
+#include <algorithm>
 #include <unordered_map>
 #include <json-c/json.h>
 
@@ -11,10 +13,12 @@
 #include "type.h"
 
 std::unordered_map<std::string, bool> cfg::config;
-std::vector<uint64_t> cfg::blacklist;
-std::vector<uint64_t> cfg::favorites;
+std::unordered_set<uint64_t> cfg::blacklist;
+std::unordered_set<uint64_t> cfg::favorites;
 static std::unordered_map<uint64_t, std::string> pathDefs;
 uint8_t cfg::sortType;
+unsigned cfg::trashMaxSizeMB, cfg::trashMaxAgeDays;
+unsigned cfg::remoteMaxTransfers, cfg::remoteMaxKBps;
 std::string cfg::driveClientID, cfg::driveClientSecret, cfg::driveRefreshToken;
 std::string cfg::webdavOrigin, cfg::webdavBasePath, cfg::webdavUser, cfg::webdavPassword;
 
@@ -25,17 +29,16 @@ static std::unordered_map<std::string, unsigned> cfgStrings =
     {"workDir", 0}, {"includeDeviceSaves", 1}, {"autoBackup", 2}, {"overclock", 3}, {"holdToDelete", 4}, {"holdToRestore", 5},
     {"holdToOverwrite", 6}, {"forceMount", 7}, {"accountSystemSaves", 8}, {"allowSystemSaveWrite", 9}, {"directFSCommands", 10},
     {"exportToZIP", 11}, {"languageOverride", 12}, {"enableTrashBin", 13}, {"titleSortType", 14}, {"animationScale", 15},
-    {"favorite", 16}, {"blacklist", 17}, {"autoName", 18}, {"driveRefreshToken", 19},
+    {"favorite", 16}, {"blacklist", 17}, {"autoName", 18}, {"driveRefreshToken", 19}, {"autoUpload", 20}, {"trashMaxSizeMB", 21},
+    {"trashMaxAgeDays", 22}, {"remoteMaxTransfers", 23}, {"remoteMaxKBps", 24},
+    {"remoteChunkedSync", 25}, {"remoteCompress", 26}
 };
 
 const std::string _true_ = "true", _false_ = "false";
 
 bool cfg::isBlacklisted(const uint64_t& tid)
 {
-    for(uint64_t& bid : cfg::blacklist)
-        if(tid == bid) return true;
-
-    return false;
+    return cfg::blacklist.find(tid) != cfg::blacklist.end();
 }
 
 //Has to be threaded to be compatible with ui::confirm
@@ -44,56 +47,31 @@ void cfg::addTitleToBlacklist(void *a)
     threadInfo *t = (threadInfo *)a;
     data::userTitleInfo *d = data::getCurrentUserTitleInfo();
     uint64_t tid = d->tid;
-    cfg::blacklist.push_back(tid);
-    for(data::user& u : data::users)
-    {
-        for(unsigned i = 0; i < u.titleInfo.size(); i++)
-            if(u.titleInfo[i].tid == tid) u.titleInfo.erase(u.titleInfo.begin() + i);
-    }
-    ui::ttlRefresh();
+    cfg::blacklist.insert(tid);
+    fs::remoteQueueRemoveTitle(tid);
+    ui::ttlRefresh(data::removeTitleSaves(tid));
     cfg::saveConfig();
     t->finished = true;
 }
 
 void cfg::removeTitleFromBlacklist(const uint64_t& tid)
 {
-    for(unsigned i = 0; i < cfg::blacklist.size(); i++)
-    {
-        if(cfg::blacklist[i] == tid)
-            cfg::blacklist.erase(cfg::blacklist.begin() + i);
-    }
-    data::loadUsersTitles(false);
-    ui::ttlRefresh();
+    cfg::blacklist.erase(tid);
+    ui::ttlRefresh(data::reloadTitleSaves(tid));
     cfg::saveConfig();
 }
 
 bool cfg::isFavorite(const uint64_t& tid)
 {
-    for(uint64_t& fid : cfg::favorites)
-        if(tid == fid) return true;
-
-    return false;
-}
-
-static int getFavoriteIndex(const uint64_t& tid)
-{
-    for(unsigned i = 0; i < cfg::favorites.size(); i++)
-    {
-        if(tid == cfg::favorites[i])
-            return i;
-    }
-    return -1;
+    return cfg::favorites.find(tid) != cfg::favorites.end();
 }
 
 void cfg::addTitleToFavorites(const uint64_t& tid)
 {
     if(cfg::isFavorite(tid))
-    {
-        int rem = getFavoriteIndex(tid);
-        cfg::favorites.erase(cfg::favorites.begin() + rem);
-    }
+        cfg::favorites.erase(tid);
     else
-        cfg::favorites.push_back(tid);
+        cfg::favorites.insert(tid);
 
     data::sortUserTitles();
     ui::ttlRefresh();
@@ -161,6 +139,12 @@ void cfg::resetConfig()
     cfg::sortType = cfg::ALPHA;
     ui::animScale = 3.0f;
     cfg::config["autoUpload"] = false;
+    cfg::trashMaxSizeMB = 0;
+    cfg::trashMaxAgeDays = 0;
+    cfg::remoteMaxTransfers = 3;
+    cfg::remoteMaxKBps = 0;
+    cfg::config["remoteChunks"] = false;
+    cfg::config["remoteGzip"] = false;
 }
 
 static inline bool textToBool(const std::string& _txt)
@@ -192,6 +176,14 @@ static inline std::string sortTypeText()
     return "";
 }
 
+//Sets don't keep any order. Sorted so saving the same config twice gives the same file.
+static std::vector<uint64_t> sortedTIDs(const std::unordered_set<uint64_t>& _tids)
+{
+    std::vector<uint64_t> ret(_tids.begin(), _tids.end());
+    std::sort(ret.begin(), ret.end());
+    return ret;
+}
+
 static void loadWorkDirLegacy()
 {
     if(fs::fileExists(workDirLegacy))
@@ -248,7 +240,7 @@ static void loadFavoritesLegacy()
     {
         fs::dataFile fav(legacyFavPath);
         while(fav.readNextLine(false))
-            cfg::favorites.push_back(strtoul(fav.getLine().c_str(), NULL, 16));
+            cfg::favorites.insert(strtoul(fav.getLine().c_str(), NULL, 16));
         fav.close();
         fs::delfile(legacyFavPath);
     }
@@ -261,7 +253,7 @@ static void loadBlacklistLegacy()
     {
         fs::dataFile bl(legacyBlPath);
         while(bl.readNextLine(false))
-            cfg::blacklist.push_back(strtoul(bl.getLine().c_str(), NULL, 16));
+            cfg::blacklist.insert(strtoul(bl.getLine().c_str(), NULL, 16));
         bl.close();
         fs::delfile(legacyBlPath);
     }
@@ -450,14 +442,14 @@ void cfg::loadConfig()
                     case 16:
                         {
                             std::string tid = cfgRead.getNextValueStr();
-                            cfg::favorites.push_back(strtoul(tid.c_str(), NULL, 16));
+                            cfg::favorites.insert(strtoul(tid.c_str(), NULL, 16));
                         }
                         break;
 
                     case 17:
                         {
                             std::string tid = cfgRead.getNextValueStr();
-                            cfg::blacklist.push_back(strtoul(tid.c_str(), NULL, 16));
+                            cfg::blacklist.insert(strtoul(tid.c_str(), NULL, 16));
                         }
                         break;
 
@@ -473,6 +465,30 @@ void cfg::loadConfig()
                         cfg::config["autoUpload"] = textToBool(cfgRead.getNextValueStr());
                         break;
 
+                    case 21:
+                        cfg::trashMaxSizeMB = cfgRead.getNextValueInt();
+                        break;
+
+                    case 22:
+                        cfg::trashMaxAgeDays = cfgRead.getNextValueInt();
+                        break;
+
+                    case 23:
+                        cfg::remoteMaxTransfers = cfgRead.getNextValueInt();
+                        break;
+
+                    case 24:
+                        cfg::remoteMaxKBps = cfgRead.getNextValueInt();
+                        break;
+
+                    case 25:
+                        cfg::config["remoteChunks"] = textToBool(cfgRead.getNextValueStr());
+                        break;
+
+                    case 26:
+                        cfg::config["remoteGzip"] = textToBool(cfgRead.getNextValueStr());
+                        break;
+
                     default:
                         break;
                 }
@@ -508,6 +524,13 @@ void cfg::saveConfig()
     fprintf(cfgOut, "exportToZIP = %s\n", boolToText(cfg::config["zip"]).c_str());
     fprintf(cfgOut, "languageOverride = %s\n", boolToText(cfg::config["langOverride"]).c_str());
     fprintf(cfgOut, "enableTrashBin = %s\n", boolToText(cfg::config["trashBin"]).c_str());
+    fprintf(cfgOut, "autoUpload = %s\n", boolToText(cfg::config["autoUpload"]).c_str());
+    fprintf(cfgOut, "trashMaxSizeMB = %u\n", cfg::trashMaxSizeMB);
+    fprintf(cfgOut, "trashMaxAgeDays = %u\n", cfg::trashMaxAgeDays);
+    fprintf(cfgOut, "remoteMaxTransfers = %u\n", cfg::remoteMaxTransfers);
+    fprintf(cfgOut, "remoteMaxKBps = %u\n", cfg::remoteMaxKBps);
+    fprintf(cfgOut, "remoteChunkedSync = %s\n", boolToText(cfg::config["remoteChunks"]).c_str());
+    fprintf(cfgOut, "remoteCompress = %s\n", boolToText(cfg::config["remoteGzip"]).c_str());
     fprintf(cfgOut, "titleSortType = %s\n", sortTypeText().c_str());
     fprintf(cfgOut, "animationScale = %f\n", ui::animScale);
 
@@ -517,14 +540,14 @@ void cfg::saveConfig()
     if(!cfg::favorites.empty())
     {
         fprintf(cfgOut, "\n#favorites\n");
-        for(uint64_t& f : cfg::favorites)
+        for(const uint64_t& f : sortedTIDs(cfg::favorites))
             fprintf(cfgOut, "favorite = 0x%016lX\n", f);
     }
 
     if(!cfg::blacklist.empty())
     {
         fprintf(cfgOut, "\n#blacklist\n");
-        for(uint64_t& b : cfg::blacklist)
+        for(const uint64_t& b : sortedTIDs(cfg::blacklist))
             fprintf(cfgOut, "blacklist = 0x%016lX\n", b);
     }
     fclose(cfgOut);
@@ -1,10 +1,116 @@
+#include <switch.h>
 #include <string>
 #include <vector>
+#include <atomic>
 #include <curl/curl.h>
 
 #include "curlfuncs.h"
 #include "util.h"
 
+//Max number of idle handles kept around
+#define POOL_MAX_IDLE 8
+
+static CURLSH *share = NULL;
+static Mutex shareLocks[CURL_LOCK_DATA_LAST];
+static Mutex poolLock = 0;
+static std::vector<CURL *> idleHandles;
+//Set per thread so only the requests of the thread that's being cancelled are aborted
+static thread_local const std::atomic<bool> *cancelFlag = NULL;
+
+static void shareLock(CURL *handle, curl_lock_data data, curl_lock_access access, void *u)
+{
+    mutexLock(&shareLocks[data]);
+}
+
+static void shareUnlock(CURL *handle, curl_lock_data data, void *u)
+{
+    mutexUnlock(&shareLocks[data]);
+}
+
+static int cancelCallback(void *u, curl_off_t dlTotal, curl_off_t dlNow, curl_off_t ulTotal, curl_off_t ulNow)
+{
+    const std::atomic<bool> *cancel = (const std::atomic<bool> *)u;
+    return cancel->load() ? 1 : 0;
+}
+
+void curlFuncs::poolInit()
+{
+    for(unsigned i = 0; i < CURL_LOCK_DATA_LAST; i++)
+        mutexInit(&shareLocks[i]);
+
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, shareLock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, shareUnlock);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    //Not the connection cache. libcurl doesn't support sharing it between handles running on different threads at once, even with locking.
+}
+
+void curlFuncs::poolExit()
+{
+    mutexLock(&poolLock);
+    for(CURL *c : idleHandles)
+        curl_easy_cleanup(c);
+    idleHandles.clear();
+    mutexUnlock(&poolLock);
+
+    if(share)
+    {
+        curl_share_cleanup(share);
+        share = NULL;
+    }
+}
+
+CURL *curlFuncs::borrowHandle()
+{
+    CURL *ret = NULL;
+    mutexLock(&poolLock);
+    if(!idleHandles.empty())
+    {
+        ret = idleHandles.back();
+        idleHandles.pop_back();
+    }
+    mutexUnlock(&poolLock);
+
+    if(!ret)
+        ret = curl_easy_init();
+
+    //Reset doesn't touch the shared caches, so every borrowed handle starts clean
+    curl_easy_reset(ret);
+    if(share)
+        curl_easy_setopt(ret, CURLOPT_SHARE, share);
+    curl_easy_setopt(ret, CURLOPT_TCP_KEEPALIVE, 1L);
+    if(cancelFlag)
+    {
+        curl_easy_setopt(ret, CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(ret, CURLOPT_XFERINFOFUNCTION, cancelCallback);
+        curl_easy_setopt(ret, CURLOPT_XFERINFODATA, cancelFlag);
+    }
+    return ret;
+}
+
+void curlFuncs::setThreadCancelFlag(const std::atomic<bool> *_cancel)
+{
+    cancelFlag = _cancel;
+}
+
+void curlFuncs::returnHandle(CURL *handle)
+{
+    if(!handle)
+        return;
+
+    mutexLock(&poolLock);
+    if(idleHandles.size() < POOL_MAX_IDLE)
+    {
+        idleHandles.push_back(handle);
+        handle = NULL;
+    }
+    mutexUnlock(&poolLock);
+
+    if(handle)
+        curl_easy_cleanup(handle);
+}
+
 size_t curlFuncs::writeDataString(const char *buff, size_t sz, size_t cnt, void *u)
 {
     std::string *str = (std::string *)u;
@@ -52,7 +158,7 @@ std::string curlFuncs::getHeader(const std::string& name, std::vector<std::strin
 std::string curlFuncs::getJSONURL(std::vector<std::string> *headers, const std::string& _url)
 {
     std::string ret;
-    CURL *handle = curl_easy_init();
+    CURL *handle = curlFuncs::borrowHandle();
     curl_easy_setopt(handle, CURLOPT_URL, _url.c_str());
     curl_easy_setopt(handle, CURLOPT_HTTPGET, 1);
     curl_easy_setopt(handle, CURLOPT_USERAGENT, "JKSV");
@@ -69,7 +175,7 @@ std::string curlFuncs::getJSONURL(std::vector<std::string> *headers, const std::
     if(curl_easy_perform(handle) != CURLE_OK)
         ret.clear();//JIC
 
-    curl_easy_cleanup(handle);
+    curlFuncs::returnHandle(handle);
     return ret;
 }
 
@@ -85,7 +191,7 @@ size_t writeDataBin(uint8_t *buff, size_t sz, size_t cnt, void *u)
 bool curlFuncs::getBinURL(std::vector<uint8_t> *out, const std::string& _url)
 {
     bool ret = false;
-    CURL *handle = curl_easy_init();
+    CURL *handle = curlFuncs::borrowHandle();
     curl_easy_setopt(handle, CURLOPT_URL, _url.c_str());
     curl_easy_setopt(handle, CURLOPT_HTTPGET, 1);
     curl_easy_setopt(handle, CURLOPT_USERAGENT, "JKSV");
@@ -96,6 +202,6 @@ bool curlFuncs::getBinURL(std::vector<uint8_t> *out, const std::string& _url)
     if(curl_easy_perform(handle) == CURLE_OK)
         ret = true;
 
-    curl_easy_cleanup(handle);
+    curlFuncs::returnHandle(handle);
     return ret;
 }
@@ -1,6 +1,12 @@
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <deque>
+#include <list>
+#include <map>
+#include <set>
 #include <string>
+#include <atomic>
 #include <cstring>
 #include <algorithm>
 #include <cstdio>
@@ -13,6 +19,33 @@
 #include "type.h"
 #include "cfg.h"
 
+//Workers used to load title info. Apps get three cores
+#define TITLE_LOAD_THREADS 3
+
+//Installed titles are kept here so they don't need to be pulled from ns and decoded every launch
+#define TITLE_CACHE_PATH "sdmc:/config/JKSV/titleCache.bin"
+#define TITLE_CACHE_MAGIC 0x4354534A
+//Bump whenever titleCacheEntry changes
+#define TITLE_CACHE_REV 2
+//Icons are decoded to this. They're never drawn much bigger
+#define TITLE_ICON_SIZE 128
+
+//Saves that mounted fine, with the timestamp and commit they had then. Only saves that changed since are test mounted again.
+#define MOUNT_CACHE_PATH "sdmc:/config/JKSV/mountCache.bin"
+#define MOUNT_CACHE_MAGIC 0x434D534A
+#define MOUNT_CACHE_REV 1
+
+//Play stats from the last time they were queried. They're used right away and refreshed in the background when older than PLAY_STATS_FRESH seconds.
+#define PLAY_STATS_PATH "sdmc:/config/JKSV/playStats.bin"
+#define PLAY_STATS_MAGIC 0x5350534A
+#define PLAY_STATS_REV 1
+#define PLAY_STATS_FRESH 300
+
+//Icons not drawn in the last frame are freed past this. About 128 cached icons
+#define ICON_TEXTURE_BUDGET 0x800000
+//Keeps a burst of finished icons from stalling a frame
+#define ICON_UPLOADS_PER_FRAME 8
+
 //FsSaveDataSpaceId_All doesn't work for SD
 static const unsigned saveOrder [] = { 0, 1, 2, 3, 4, 100, 101 };
 
@@ -26,8 +59,13 @@ SetLanguage data::sysLang;
 
 //For other save types
 static bool sysBCATPushed = false, tempPushed = false;
+//Special users kept at the end of users
+static unsigned systemUserCount = 4;
 std::unordered_map<uint64_t, data::titleInfo> data::titles;
 
+//Held while the title cache is read or rewritten so the icon loader doesn't read it halfway through
+static Mutex titleCacheLock = 0;
+
 //Sorts titles by sortType
 static struct
 {
@@ -40,20 +78,9 @@ static struct
         {
             case cfg::ALPHA:
                 {
-                    std::string titleA = data::getTitleNameByTID(a.tid);
-                    std::string titleB = data::getTitleNameByTID(b.tid);
-                    uint32_t pointA, pointB;
-                    for(unsigned i = 0, j = 0; i < titleA.length(); )
-                    {
-                        ssize_t aCnt = decode_utf8(&pointA, (const uint8_t *)&titleA.data()[i]);
-                        ssize_t bCnt = decode_utf8(&pointB, (const uint8_t *)&titleB.data()[j]);
-                        pointA = tolower(pointA), pointB = tolower(pointB);
-                        if(pointA != pointB)
-                            return pointA < pointB;
-
-                        i += aCnt;
-                        j += bCnt;
-                    }
+                    auto titleA = data::titles.find(a.tid), titleB = data::titles.find(b.tid);
+                    if(titleA != data::titles.end() && titleB != data::titles.end())
+                        return titleA->second.sortKey < titleB->second.sortKey;
                 }
                 break;
 
@@ -87,68 +114,286 @@ static inline bool accountSystemSaveCheck(const FsSaveDataInfo& _inf)
     return true;
 }
 
+typedef struct
+{
+    uint32_t magic, rev, count;
+} cacheHeader;
+
+typedef struct
+{
+    uint64_t saveID, timestamp, commitID;
+} mountCacheEntry;
+
+static std::unordered_map<uint64_t, mountCacheEntry> mountCache;
+//Saves checked this pass. Anything else is gone and dropped when the cache is saved.
+static std::unordered_set<uint64_t> mountCacheSeen;
+static bool mountCacheLoaded = false, mountCacheChanged = false;
+
+static void mountCacheLoad()
+{
+    mountCacheLoaded = true;
+    FILE *cacheIn = fopen(MOUNT_CACHE_PATH, "rb");
+    if(!cacheIn)
+        return;
+
+    cacheHeader head;
+    if(fread(&head, sizeof(cacheHeader), 1, cacheIn) == 1 && head.magic == MOUNT_CACHE_MAGIC && head.rev == MOUNT_CACHE_REV)
+    {
+        mountCacheEntry entry;
+        for(uint32_t i = 0; i < head.count && fread(&entry, sizeof(mountCacheEntry), 1, cacheIn) == 1; i++)
+            mountCache[entry.saveID] = entry;
+    }
+    fclose(cacheIn);
+}
+
+static void mountCacheSave()
+{
+    for(auto ent = mountCache.begin(); ent != mountCache.end(); )
+    {
+        if(mountCacheSeen.find(ent->first) == mountCacheSeen.end())
+        {
+            ent = mountCache.erase(ent);
+            mountCacheChanged = true;
+        }
+        else
+            ++ent;
+    }
+
+    if(!mountCacheChanged)
+        return;
+
+    FILE *cacheOut = fopen(MOUNT_CACHE_PATH, "wb");
+    if(!cacheOut)
+        return;
+
+    cacheHeader head = { MOUNT_CACHE_MAGIC, MOUNT_CACHE_REV, (uint32_t)mountCache.size() };
+    fwrite(&head, sizeof(cacheHeader), 1, cacheOut);
+    for(auto& ent : mountCache)
+        fwrite(&ent.second, sizeof(mountCacheEntry), 1, cacheOut);
+    fclose(cacheOut);
+    mountCacheChanged = false;
+}
+
 //Minimal init/test to avoid loading and creating things I don't need
+//Reading the extra data is one call instead of a full mount, so saves that haven't changed since they last mounted are trusted.
+//Failures aren't cached since a save can just be in use by something else at the time.
 static bool testMount(const FsSaveDataInfo& _inf)
 {
     bool ret = false;
     if(!cfg::config["forceMount"])
         return true;
 
+    FsSaveDataExtraData extra;
+    bool haveExtra = R_SUCCEEDED(fsReadSaveDataFileSystemExtraDataBySaveDataSpaceId(&extra, sizeof(FsSaveDataExtraData), (FsSaveDataSpaceId)_inf.save_data_space_id, _inf.save_data_id));
+    if(haveExtra)
+    {
+        mountCacheSeen.insert(_inf.save_data_id);
+        auto cached = mountCache.find(_inf.save_data_id);
+        if(cached != mountCache.end() && cached->second.timestamp == extra.timestamp && cached->second.commitID == extra.commit_id)
+            return true;
+    }
+
     if((ret = fs::mountSave(_inf)))
         fs::unmountSave();
 
+    if(haveExtra && ret)
+    {
+        mountCache[_inf.save_data_id] = { _inf.save_data_id, extra.timestamp, extra.commit_id };
+        mountCacheChanged = true;
+    }
+    else if(haveExtra && mountCache.erase(_inf.save_data_id) > 0)
+        mountCacheChanged = true;
+
     return ret;
 }
 
-static inline void addTitleToList(const uint64_t& tid)
+//The icon's original JPEG follows each entry, so entries aren't all the same size
+typedef struct
 {
-    uint64_t outSize = 0;
-    NsApplicationControlData *ctrlData = new NsApplicationControlData;
+    //Compared to the title's current record. Anything that changed is loaded again
+    NsApplicationRecord record;
+    //Language title and author were picked for. Changing it loads them again
+    uint32_t lang;
+    data::titleNacp nacp;
+    char title[0x200], author[0x100];
+    //Title is the English one because there wasn't one for lang
+    uint8_t titleFallback;
+    uint32_t iconSize;
+} titleCacheEntry;
+
+typedef struct
+{
+    FILE *out;
+    uint32_t count;
+    const std::unordered_map<uint64_t, NsApplicationRecord> *records;
+} titleCacheWriter;
+
+typedef struct
+{
+    uint64_t tid;
+    data::titleInfo *info;
+    //Only kept for titles going into the cache. Everything else waits until it's drawn.
+    bool cacheIcon;
+    std::vector<uint8_t> iconJpeg;
+    bool titleFallback;
+} titleLoadJob;
+
+typedef struct
+{
+    std::vector<titleLoadJob> *jobs;
+    std::atomic<unsigned> next;
+} titleLoadPool;
+
+static void copyTitleNacp(data::titleNacp *_out, const NacpStruct *_nacp)
+{
+    _out->save_data_owner_id = _nacp->save_data_owner_id;
+    _out->user_account_save_data_size = _nacp->user_account_save_data_size;
+    _out->user_account_save_data_journal_size = _nacp->user_account_save_data_journal_size;
+    _out->user_account_save_data_journal_size_max = _nacp->user_account_save_data_journal_size_max;
+    _out->device_save_data_size = _nacp->device_save_data_size;
+    _out->device_save_data_journal_size = _nacp->device_save_data_journal_size;
+    _out->device_save_data_journal_size_max = _nacp->device_save_data_journal_size_max;
+    _out->bcat_delivery_cache_storage_size = _nacp->bcat_delivery_cache_storage_size;
+    _out->cache_storage_size = _nacp->cache_storage_size;
+    _out->cache_storage_journal_size = _nacp->cache_storage_journal_size;
+    _out->cache_storage_data_and_journal_size_max = _nacp->cache_storage_data_and_journal_size_max;
+}
+
+//Setup 'shortcuts' to strings. A title that's the English fallback doesn't get used for safeTitle
+static void setTitleStrings(const uint64_t& tid, data::titleInfo *_info, const char *_title, const char *_author, bool _fallback)
+{
+    _info->title = _title;
+    _info->sortKey = util::getSortKey(_info->title);
+    _info->author = _author;
+    if(cfg::isDefined(tid))
+        _info->safeTitle = cfg::getPathDefinition(tid);
+    else if(_fallback || (_info->safeTitle = util::safeString(_title)) == "")
+        _info->safeTitle = util::getIDStr(tid);
+}
+
+//Returns whether the title is the English fallback
+static bool setTitleFromNacp(const uint64_t& tid, data::titleInfo *_info, const NacpStruct *_nacp)
+{
+    NacpLanguageEntry *ent;
+    nacpGetLanguageEntry((NacpStruct *)_nacp, &ent);
+    copyTitleNacp(&_info->nacp, _nacp);
+
+    bool fallback = strlen(ent->name) == 0;
+    setTitleStrings(tid, _info, fallback ? _nacp->lang[SetLanguage_ENUS].name : ent->name, ent->author, fallback);
+    return fallback;
+}
+
+//Runs on the workers. Only touches _job, so no locking is needed
+static void loadTitleInfo(titleLoadJob& _job, NsApplicationControlData *ctrlData)
+{
+    uint64_t tid = _job.tid, outSize = 0;
+    data::titleInfo *info = _job.info;
     NacpLanguageEntry *ent;
     Result ctrlRes = nsGetApplicationControlData(NsApplicationControlSource_Storage, tid, ctrlData, sizeof(NsApplicationControlData), &outSize);
     Result nacpRes = nacpGetLanguageEntry(&ctrlData->nacp, &ent);
     size_t iconSize = outSize - sizeof(ctrlData->nacp);
 
+    info->fav = cfg::isFavorite(tid);
     if(R_SUCCEEDED(ctrlRes) && !(outSize < sizeof(ctrlData->nacp)) && R_SUCCEEDED(nacpRes) && iconSize > 0)
     {
-        //Copy nacp
-        memcpy(&data::titles[tid].nacp, &ctrlData->nacp, sizeof(NacpStruct));
-
-        //Setup 'shortcuts' to strings
-        NacpLanguageEntry *ent;
-        nacpGetLanguageEntry(&data::titles[tid].nacp, &ent);
-        if(strlen(ent->name) == 0)
-            data::titles[tid].title = ctrlData->nacp.lang[SetLanguage_ENUS].name;
-        else
-            data::titles[tid].title = ent->name;
-        data::titles[tid].author = ent->author;
-        if(cfg::isDefined(tid))
-            data::titles[tid].safeTitle = cfg::getPathDefinition(tid);
-        else if((data::titles[tid].safeTitle = util::safeString(ent->name)) == "")
-            data::titles[tid].safeTitle = util::getIDStr(tid);
+        _job.titleFallback = setTitleFromNacp(tid, info, &ctrlData->nacp);
 
-        if(cfg::isFavorite(tid))
-            data::titles[tid].fav = true;
-        
-        data::titles[tid].icon = gfx::texMgr->textureLoadFromMem(IMG_FMT_JPG, ctrlData->icon, iconSize);
-        if(!data::titles[tid].icon)
-            data::titles[tid].icon = util::createIconGeneric(util::getIDStrLower(tid).c_str(), 32, true);
+        if(_job.cacheIcon)
+            _job.iconJpeg.assign(ctrlData->icon, ctrlData->icon + iconSize);
     }
     else
     {
-        memset(&data::titles[tid].nacp, 0, sizeof(NacpStruct));
-        data::titles[tid].title = util::getIDStr(tid);
-        data::titles[tid].author = "Someone?";
+        memset(&info->nacp, 0, sizeof(data::titleNacp));
+        info->title = util::getIDStr(tid);
+        info->sortKey = util::getSortKey(info->title);
+        info->author = "Someone?";
         if(cfg::isDefined(tid))
-            data::titles[tid].safeTitle = cfg::getPathDefinition(tid);
+            info->safeTitle = cfg::getPathDefinition(tid);
         else
-            data::titles[tid].safeTitle = util::getIDStr(tid);
-
-        data::titles[tid].icon = util::createIconGeneric(util::getIDStrLower(tid).c_str(), 32, true);
+            info->safeTitle = util::getIDStr(tid);
     }
+}
+
+static void titleLoad_t(void *a)
+{
+    titleLoadPool *pool = (titleLoadPool *)a;
+    //One of these per worker instead of one per title
+    NsApplicationControlData *ctrlData = new NsApplicationControlData;
+
+    unsigned i;
+    while((i = pool->next++) < pool->jobs->size())
+        loadTitleInfo((*pool->jobs)[i], ctrlData);
+
     delete ctrlData;
 }
 
+//Titles that aren't installed aren't cached.
+static void titleCacheAdd(titleCacheWriter *_cache, const titleLoadJob& _job)
+{
+    auto rec = _cache->records->find(_job.tid);
+    if(_job.iconJpeg.empty() || rec == _cache->records->end())
+        return;
+
+    titleCacheEntry entry;
+    memset(&entry, 0, sizeof(titleCacheEntry));
+    entry.record = rec->second;
+    entry.lang = data::sysLang;
+    entry.nacp = _job.info->nacp;
+    strncpy(entry.title, _job.info->title.c_str(), sizeof(entry.title) - 1);
+    strncpy(entry.author, _job.info->author.c_str(), sizeof(entry.author) - 1);
+    entry.titleFallback = _job.titleFallback;
+    entry.iconSize = _job.iconJpeg.size();
+
+    long offset = ftell(_cache->out);
+    if(fwrite(&entry, sizeof(titleCacheEntry), 1, _cache->out) == 1 && fwrite(_job.iconJpeg.data(), 1, entry.iconSize, _cache->out) == entry.iconSize)
+    {
+        _job.info->iconOffset = offset + sizeof(titleCacheEntry);
+        _cache->count++;
+    }
+}
+
+//Fetching control data and decoding icons is split across a worker per core. Icons are only kept in the cache.
+static void addTitlesToList(const std::vector<uint64_t>& _tids, titleCacheWriter *_cache = NULL)
+{
+    if(_tids.empty())
+        return;
+
+    //Entries are made here so the workers never change the map
+    std::vector<titleLoadJob> jobs;
+    for(const uint64_t& tid : _tids)
+    {
+        bool cacheIcon = _cache && _cache->out && _cache->records->find(tid) != _cache->records->end();
+        jobs.push_back({ tid, &data::titles[tid], cacheIcon, {}, false });
+    }
+
+    titleLoadPool pool;
+    pool.jobs = &jobs;
+    pool.next = 0;
+
+    Thread workers[TITLE_LOAD_THREADS];
+    unsigned started = 0;
+    for(unsigned i = 0; i < TITLE_LOAD_THREADS && i < jobs.size(); i++)
+    {
+        if(R_SUCCEEDED(threadCreate(&workers[started], titleLoad_t, &pool, NULL, 0x40000, 0x2C, i)))
+            threadStart(&workers[started++]);
+    }
+
+    //Whatever the workers didn't get to, or everything if none could be started
+    titleLoad_t(&pool);
+
+    for(unsigned i = 0; i < started; i++)
+    {
+        threadWaitForExit(&workers[i]);
+        threadClose(&workers[i]);
+    }
+
+    for(titleLoadJob& job : jobs)
+    {
+        if(job.cacheIcon)
+            titleCacheAdd(_cache, job);
+    }
+}
+
 static inline bool titleIsLoaded(const uint64_t& tid)
 {
     auto findTid = data::titles.find(tid);
@@ -168,16 +413,168 @@ static void loadUserAccounts()
     delete[] uids;
 }
 
+//Returns NULL if there isn't a cache or it's from a different version
+static FILE *titleCacheOpen(uint32_t *_count)
+{
+    FILE *cacheIn = fopen(TITLE_CACHE_PATH, "rb");
+    if(!cacheIn)
+        return NULL;
+
+    cacheHeader head;
+    if(fread(&head, sizeof(cacheHeader), 1, cacheIn) != 1 || head.magic != TITLE_CACHE_MAGIC || head.rev != TITLE_CACHE_REV)
+    {
+        fclose(cacheIn);
+        return NULL;
+    }
+    *_count = head.count;
+    return cacheIn;
+}
+
+static bool titleCacheEntryValid(const titleCacheEntry *_entry, const std::unordered_map<uint64_t, NsApplicationRecord>& _records)
+{
+    auto rec = _records.find(_entry->record.application_id);
+    return rec != _records.end() && memcmp(&rec->second, &_entry->record, sizeof(NsApplicationRecord)) == 0 && _entry->lang == (uint32_t)data::sysLang;
+}
+
+//Icon is left in the file until it's drawn
+static void loadTitleFromCache(titleCacheEntry *_entry, long _offset)
+{
+    uint64_t tid = _entry->record.application_id;
+    data::titleInfo *info = &data::titles[tid];
+    _entry->title[sizeof(_entry->title) - 1] = 0x00;
+    _entry->author[sizeof(_entry->author) - 1] = 0x00;
+    info->nacp = _entry->nacp;
+    setTitleStrings(tid, info, _entry->title, _entry->author, _entry->titleFallback);
+    info->fav = cfg::isFavorite(tid);
+    info->iconOffset = _offset + sizeof(titleCacheEntry);
+}
+
+//Starts a new cache with whatever is still valid in the old one. Titles loaded after are added by addTitlesToList.
+static FILE *titleCacheRewrite(const std::unordered_map<uint64_t, NsApplicationRecord>& _records, uint32_t *_count)
+{
+    std::string tmpPath = std::string(TITLE_CACHE_PATH) + ".tmp";
+    FILE *cacheOut = fopen(tmpPath.c_str(), "wb");
+    if(!cacheOut)
+        return NULL;
+
+    cacheHeader head = { TITLE_CACHE_MAGIC, TITLE_CACHE_REV, 0 };
+    fwrite(&head, sizeof(cacheHeader), 1, cacheOut);
+
+    *_count = 0;
+    uint32_t oldCount = 0;
+    FILE *cacheIn = titleCacheOpen(&oldCount);
+    if(cacheIn)
+    {
+        titleCacheEntry entry;
+        std::vector<uint8_t> icon;
+        std::unordered_set<uint64_t> copied;
+        for(uint32_t i = 0; i < oldCount && fread(&entry, sizeof(titleCacheEntry), 1, cacheIn) == 1; i++)
+        {
+            icon.resize(entry.iconSize);
+            if(fread(icon.data(), 1, icon.size(), cacheIn) != icon.size())
+                break;
+
+            uint64_t tid = entry.record.application_id;
+            if(!titleCacheEntryValid(&entry, _records) || !copied.insert(tid).second)
+                continue;
+
+            long offset = ftell(cacheOut);
+            if(fwrite(&entry, sizeof(titleCacheEntry), 1, cacheOut) != 1 || fwrite(icon.data(), 1, icon.size(), cacheOut) != icon.size())
+                continue;
+
+            ++*_count;
+            //Icons already pointing into the old file have to follow it
+            auto title = data::titles.find(tid);
+            if(title != data::titles.end() && title->second.iconOffset >= 0)
+                title->second.iconOffset = offset + sizeof(titleCacheEntry);
+        }
+        fclose(cacheIn);
+    }
+    return cacheOut;
+}
+
+static void titleCacheFinish(FILE *_cacheOut, uint32_t _count)
+{
+    cacheHeader head = { TITLE_CACHE_MAGIC, TITLE_CACHE_REV, _count };
+    fseek(_cacheOut, 0, SEEK_SET);
+    bool ok = fwrite(&head, sizeof(cacheHeader), 1, _cacheOut) == 1;
+    ok = fclose(_cacheOut) == 0 && ok;
+
+    std::string tmpPath = std::string(TITLE_CACHE_PATH) + ".tmp";
+    if(ok)
+    {
+        remove(TITLE_CACHE_PATH);
+        rename(tmpPath.c_str(), TITLE_CACHE_PATH);
+    }
+    else
+        remove(tmpPath.c_str());
+}
+
 //This can load titles installed without having save data
+//Titles whose record matches the cached one come from TITLE_CACHE_PATH. Only new or changed titles go through ns.
 static void loadTitlesFromRecords()
 {
     NsApplicationRecord nsRecord;
     int32_t entryCount = 0, recordOffset = 0;
+    //Every installed title, so entries for ones already loaded are kept when the cache is rewritten
+    std::unordered_map<uint64_t, NsApplicationRecord> records;
     while(R_SUCCEEDED(nsListApplicationRecord(&nsRecord, 1, recordOffset++, &entryCount)) && entryCount > 0)
+        records[nsRecord.application_id] = nsRecord;
+
+    std::vector<uint64_t> newTitles;
+    for(auto& rec : records)
     {
-        if(!titleIsLoaded(nsRecord.application_id))
-            addTitleToList(nsRecord.application_id);
+        if(!titleIsLoaded(rec.first))
+            newTitles.push_back(rec.first);
     }
+
+    if(newTitles.empty())
+        return;
+
+    //Only the title info is read here. Icons are read from the cache when they're drawn.
+    //Anything in the cache that's stale, doubled or no longer installed means it gets rewritten
+    bool rewrite = false;
+    uint32_t cacheCount = 0;
+    titleCacheEntry entry;
+    std::unordered_set<uint64_t> seen;
+    mutexLock(&titleCacheLock);
+    FILE *cacheIn = titleCacheOpen(&cacheCount);
+    if(cacheIn)
+    {
+        uint32_t i;
+        long offset = ftell(cacheIn);
+        for(i = 0; i < cacheCount && fread(&entry, sizeof(titleCacheEntry), 1, cacheIn) == 1; i++)
+        {
+            uint64_t tid = entry.record.application_id;
+            if(!titleCacheEntryValid(&entry, records) || !seen.insert(tid).second)
+                rewrite = true;
+            else if(!titleIsLoaded(tid))
+                loadTitleFromCache(&entry, offset);
+
+            offset += sizeof(titleCacheEntry) + entry.iconSize;
+            if(fseek(cacheIn, offset, SEEK_SET) != 0)
+                break;
+        }
+        rewrite = rewrite || i < cacheCount;
+        fclose(cacheIn);
+    }
+
+    newTitles.clear();
+    for(auto& rec : records)
+    {
+        if(!titleIsLoaded(rec.first))
+            newTitles.push_back(rec.first);
+    }
+
+    if(rewrite || !newTitles.empty())
+    {
+        titleCacheWriter cache = { NULL, 0, &records };
+        cache.out = titleCacheRewrite(records, &cache.count);
+        addTitlesToList(newTitles, &cache);
+        if(cache.out)
+            titleCacheFinish(cache.out, cache.count);
+    }
+    mutexUnlock(&titleCacheLock);
 }
 
 static void importSVIs()
@@ -203,21 +600,13 @@ static void importSVIs()
             if(!titleIsLoaded(tid))
             {
                 nacpGetLanguageEntry(nacp, &ent);
-                memcpy(&data::titles[tid].nacp, nacp, sizeof(NacpStruct));
-                data::titles[tid].title = ent->name;
-                data::titles[tid].author = ent->author;
-                if(cfg::isDefined(tid))
-                    data::titles[tid].safeTitle = cfg::getPathDefinition(tid);
-                else if((data::titles[tid].safeTitle = util::safeString(ent->name)) == "")
-                    data::titles[tid].safeTitle = util::getIDStr(tid);
+                copyTitleNacp(&data::titles[tid].nacp, nacp);
+                setTitleStrings(tid, &data::titles[tid], ent->name, ent->author, false);
 
                 if(cfg::isFavorite(tid))
                     data::titles[tid].fav = true;
 
-                if(!data::titles[tid].icon && iconSize > 0)
-                    data::titles[tid].icon = gfx::texMgr->textureLoadFromMem(IMG_FMT_JPG, iconBuffer, iconSize);
-                else if(!data::titles[tid].icon && iconSize == 0)
-                    data::titles[tid].icon = util::createIconGeneric(util::getIDStrLower(tid).c_str(), 32, true);
+                data::titles[tid].iconJpeg.assign(iconBuffer, iconBuffer + iconSize);
             }
             delete nacp;
             delete[] iconBuffer;
@@ -226,12 +615,474 @@ static void importSVIs()
     }
 }
 
+typedef struct
+{
+    uint64_t tid;
+    long offset;
+    std::vector<uint8_t> jpeg;
+} iconRequest;
+
+typedef struct
+{
+    uint64_t tid;
+    SDL_Surface *icon;
+} iconResult;
+
+typedef struct
+{
+    uint64_t tid, lastDrawn;
+    size_t size;
+} iconUse;
+
+static Thread iconThread;
+static Mutex iconLock = 0;
+static CondVar iconCond = 0;
+static bool iconThreadRunning = false;
+//Newest requests are at the front since they're most likely still on screen
+static std::deque<iconRequest> iconRequests;
+static std::vector<iconResult> iconResults;
+//Requested but not turned into a texture yet
+static std::unordered_set<uint64_t> iconPending;
+//Only touched on the main thread. Most recently drawn first
+static std::list<iconUse> iconLRU;
+static std::unordered_map<uint64_t, std::list<iconUse>::iterator> iconLRUPos;
+static size_t iconBytes = 0;
+static uint64_t iconFrame = 0;
+static SDL_Texture *iconPlaceholder = NULL;
+
+static SDL_Surface *iconReadCache(const iconRequest& _req)
+{
+    SDL_Surface *ret = NULL;
+    mutexLock(&titleCacheLock);
+    FILE *cacheIn = fopen(TITLE_CACHE_PATH, "rb");
+    if(cacheIn)
+    {
+        //Make sure the cache wasn't rewritten since the offset was taken
+        titleCacheEntry entry;
+        std::vector<uint8_t> jpeg;
+        long entryOffset = _req.offset - sizeof(titleCacheEntry);
+        if(fseek(cacheIn, entryOffset, SEEK_SET) == 0 && fread(&entry, sizeof(titleCacheEntry), 1, cacheIn) == 1 && entry.record.application_id == _req.tid)
+        {
+            jpeg.resize(entry.iconSize);
+            if(fread(jpeg.data(), 1, jpeg.size(), cacheIn) != jpeg.size())
+                jpeg.clear();
+        }
+        fclose(cacheIn);
+        mutexUnlock(&titleCacheLock);
+
+        //Decoded outside the lock
+        if(!jpeg.empty())
+            ret = gfx::surfaceResize(gfx::surfaceLoadFromMem(IMG_FMT_JPG, jpeg.data(), jpeg.size()), TITLE_ICON_SIZE, TITLE_ICON_SIZE);
+        return ret;
+    }
+    mutexUnlock(&titleCacheLock);
+    return ret;
+}
+
+static SDL_Surface *iconReadControlData(const uint64_t& _tid)
+{
+    SDL_Surface *ret = NULL;
+    uint64_t outSize = 0;
+    NsApplicationControlData *ctrlData = new NsApplicationControlData;
+    if(R_SUCCEEDED(nsGetApplicationControlData(NsApplicationControlSource_Storage, _tid, ctrlData, sizeof(NsApplicationControlData), &outSize)) && outSize > sizeof(ctrlData->nacp))
+        ret = gfx::surfaceResize(gfx::surfaceLoadFromMem(IMG_FMT_JPG, ctrlData->icon, outSize - sizeof(ctrlData->nacp)), TITLE_ICON_SIZE, TITLE_ICON_SIZE);
+    delete ctrlData;
+    return ret;
+}
+
+//Decodes icons off the main thread. The texture is made by iconUpdate.
+static void iconLoad_t(void *a)
+{
+    mutexLock(&iconLock);
+    while(iconThreadRunning)
+    {
+        if(iconRequests.empty())
+        {
+            condvarWait(&iconCond, &iconLock);
+            continue;
+        }
+
+        iconRequest req = iconRequests.front();
+        iconRequests.pop_front();
+        mutexUnlock(&iconLock);
+
+        SDL_Surface *icon = NULL;
+        if(!req.jpeg.empty())
+            icon = gfx::surfaceResize(gfx::surfaceLoadFromMem(IMG_FMT_JPG, req.jpeg.data(), req.jpeg.size()), TITLE_ICON_SIZE, TITLE_ICON_SIZE);
+        if(!icon && req.offset >= 0)
+            icon = iconReadCache(req);
+        if(!icon)
+            icon = iconReadControlData(req.tid);
+
+        mutexLock(&iconLock);
+        iconResults.push_back({ req.tid, icon });
+    }
+    mutexUnlock(&iconLock);
+}
+
+static void iconRequestLoad(const uint64_t& tid, const data::titleInfo& _info)
+{
+    mutexLock(&iconLock);
+    if(!iconThreadRunning)
+    {
+        iconThreadRunning = true;
+        if(R_SUCCEEDED(threadCreate(&iconThread, iconLoad_t, NULL, NULL, 0x40000, 0x2C, -2)))
+            threadStart(&iconThread);
+        else
+            iconThreadRunning = false;
+    }
+
+    if(iconThreadRunning)
+    {
+        iconPending.insert(tid);
+        iconRequests.push_front({ tid, _info.iconOffset, _info.iconJpeg });
+        condvarWakeOne(&iconCond);
+    }
+    mutexUnlock(&iconLock);
+}
+
+static void iconStopLoader()
+{
+    mutexLock(&iconLock);
+    bool running = iconThreadRunning;
+    iconThreadRunning = false;
+    condvarWakeAll(&iconCond);
+    mutexUnlock(&iconLock);
+
+    if(running)
+    {
+        threadWaitForExit(&iconThread);
+        threadClose(&iconThread);
+    }
+
+    for(iconResult& res : iconResults)
+    {
+        if(res.icon)
+            SDL_FreeSurface(res.icon);
+    }
+    iconResults.clear();
+    iconRequests.clear();
+    iconPending.clear();
+}
+
+typedef struct
+{
+    uint64_t tid;
+    AccountUid uid;
+    //time() of the query
+    uint64_t fetched;
+    PdmPlayStatistics stats;
+} playStatsEntry;
+
+typedef std::pair<u128, uint64_t> playStatsKey;
+
+static std::map<playStatsKey, playStatsEntry> playStatsCache;
+//Waiting to be queried, and queried but not applied yet. Both go through playStatsLock
+static std::vector<playStatsEntry> playStatsQueue, playStatsDone;
+static std::set<playStatsKey> playStatsQueued;
+static Mutex playStatsLock = 0;
+static Thread playStatsThread;
+static bool playStatsLoaded = false, playStatsRunning = false, playStatsStop = false, playStatsChanged = false, playStatsThreadOpen = false;
+
+static void playStatsLoad()
+{
+    playStatsLoaded = true;
+    FILE *statsIn = fopen(PLAY_STATS_PATH, "rb");
+    if(!statsIn)
+        return;
+
+    cacheHeader head;
+    if(fread(&head, sizeof(cacheHeader), 1, statsIn) == 1 && head.magic == PLAY_STATS_MAGIC && head.rev == PLAY_STATS_REV)
+    {
+        playStatsEntry entry;
+        for(uint32_t i = 0; i < head.count && fread(&entry, sizeof(playStatsEntry), 1, statsIn) == 1; i++)
+            playStatsCache[playStatsKey(util::accountUIDToU128(entry.uid), entry.tid)] = entry;
+    }
+    fclose(statsIn);
+}
+
+static void playStatsSave()
+{
+    if(!playStatsChanged)
+        return;
+
+    FILE *statsOut = fopen(PLAY_STATS_PATH, "wb");
+    if(!statsOut)
+        return;
+
+    cacheHeader head = { PLAY_STATS_MAGIC, PLAY_STATS_REV, (uint32_t)playStatsCache.size() };
+    fwrite(&head, sizeof(cacheHeader), 1, statsOut);
+    for(auto& ent : playStatsCache)
+        fwrite(&ent.second, sizeof(playStatsEntry), 1, statsOut);
+    fclose(statsOut);
+    playStatsChanged = false;
+}
+
+//Returns the cached stats, or zeros if there aren't any yet. Anything missing or old is queued for playStatsStart.
+static void playStatsGet(const uint64_t& tid, const AccountUid& uid, PdmPlayStatistics *_stats)
+{
+    if(!playStatsLoaded)
+        playStatsLoad();
+
+    playStatsKey key(util::accountUIDToU128(uid), tid);
+    auto cached = playStatsCache.find(key);
+    if(cached != playStatsCache.end())
+        memcpy(_stats, &cached->second.stats, sizeof(PdmPlayStatistics));
+    else
+        memset(_stats, 0, sizeof(PdmPlayStatistics));
+
+    if(cached != playStatsCache.end() && cached->second.fetched + PLAY_STATS_FRESH > (uint64_t)time(NULL))
+        return;
+
+    mutexLock(&playStatsLock);
+    if(playStatsQueued.insert(key).second)
+        playStatsQueue.push_back({ tid, uid, 0, *_stats });
+    mutexUnlock(&playStatsLock);
+}
+
+static void playStats_t(void *a)
+{
+    while(true)
+    {
+        mutexLock(&playStatsLock);
+        if(playStatsQueue.empty() || playStatsStop)
+        {
+            playStatsRunning = false;
+            mutexUnlock(&playStatsLock);
+            break;
+        }
+        playStatsEntry entry = playStatsQueue.back();
+        playStatsQueue.pop_back();
+        mutexUnlock(&playStatsLock);
+
+        if(R_SUCCEEDED(pdmqryQueryPlayStatisticsByApplicationIdAndUserAccountId(entry.tid, entry.uid, false, &entry.stats)))
+            entry.fetched = time(NULL);
+
+        mutexLock(&playStatsLock);
+        playStatsDone.push_back(entry);
+        mutexUnlock(&playStatsLock);
+    }
+}
+
+//Starts querying whatever playStatsGet queued
+static void playStatsStart()
+{
+    //Checked and claimed together so two callers can't both start one
+    mutexLock(&playStatsLock);
+    bool start = !playStatsRunning && !playStatsStop && !playStatsQueue.empty();
+    if(start)
+        playStatsRunning = true;
+    mutexUnlock(&playStatsLock);
+    if(!start)
+        return;
+
+    //Last one has to be closed before the handle is reused. It's already done or about to be.
+    if(playStatsThreadOpen)
+    {
+        threadWaitForExit(&playStatsThread);
+        threadClose(&playStatsThread);
+        playStatsThreadOpen = false;
+    }
+
+    if(R_SUCCEEDED(threadCreate(&playStatsThread, playStats_t, NULL, NULL, 0x8000, 0x3B, -2)))
+    {
+        playStatsThreadOpen = true;
+        threadStart(&playStatsThread);
+    }
+    else
+    {
+        mutexLock(&playStatsLock);
+        playStatsRunning = false;
+        mutexUnlock(&playStatsLock);
+    }
+}
+
+//Copies finished stats into every save they belong to. Users whose stats changed are re-sorted if that matters.
+static void playStatsUpdate()
+{
+    std::vector<playStatsEntry> done;
+    mutexLock(&playStatsLock);
+    done.swap(playStatsDone);
+    for(playStatsEntry& entry : done)
+        playStatsQueued.erase(playStatsKey(util::accountUIDToU128(entry.uid), entry.tid));
+    bool finished = !playStatsRunning && playStatsQueue.empty();
+    mutexUnlock(&playStatsLock);
+
+    std::map<playStatsKey, const playStatsEntry *> changedStats;
+    for(playStatsEntry& entry : done)
+    {
+        //Failed queries keep whatever was there
+        if(entry.fetched == 0)
+            continue;
+
+        playStatsKey key(util::accountUIDToU128(entry.uid), entry.tid);
+        playStatsEntry& cached = playStatsCache[key];
+        bool statsChanged = memcmp(&cached.stats, &entry.stats, sizeof(PdmPlayStatistics)) != 0;
+        cached = entry;
+        playStatsChanged = true;
+        if(statsChanged)
+            changedStats[key] = &cached;
+    }
+
+    std::vector<unsigned> changedUsers;
+    for(unsigned i = 0; i < data::users.size() && !changedStats.empty(); i++)
+    {
+        for(data::userTitleInfo& t : data::users[i].titleInfo)
+        {
+            FsSaveDataInfo& inf = t.saveInfo;
+            if(inf.save_data_type != FsSaveDataType_Account && inf.save_data_type != FsSaveDataType_Device)
+                continue;
+
+            auto stats = changedStats.find(playStatsKey(util::accountUIDToU128(inf.uid), inf.application_id));
+            if(stats == changedStats.end())
+                continue;
+
+            memcpy(&t.playStats, &stats->second->stats, sizeof(PdmPlayStatistics));
+            if(changedUsers.empty() || changedUsers.back() != i)
+                changedUsers.push_back(i);
+        }
+    }
+
+    if(cfg::sortType != cfg::ALPHA && !changedUsers.empty())
+    {
+        //selData is only an index and open panels act on it, so it has to follow the save it pointed at
+        uint64_t selSaveID = 0;
+        if(selUser < (int)data::users.size() && selData < (int)data::users[selUser].titleInfo.size())
+            selSaveID = data::users[selUser].titleInfo[selData].saveInfo.save_data_id;
+
+        for(unsigned u : changedUsers)
+            std::sort(data::users[u].titleInfo.begin(), data::users[u].titleInfo.end(), sortTitles);
+
+        if(selSaveID != 0)
+        {
+            std::vector<data::userTitleInfo>& selTitles = data::users[selUser].titleInfo;
+            for(unsigned i = 0; i < selTitles.size(); i++)
+            {
+                if(selTitles[i].saveInfo.save_data_id == selSaveID)
+                {
+                    selData = i;
+                    break;
+                }
+            }
+        }
+        ui::ttlRefresh(changedUsers);
+    }
+
+    if(finished)
+        playStatsSave();
+}
+
+static void playStatsExit()
+{
+    mutexLock(&playStatsLock);
+    playStatsStop = true;
+    mutexUnlock(&playStatsLock);
+
+    if(playStatsThreadOpen)
+    {
+        threadWaitForExit(&playStatsThread);
+        threadClose(&playStatsThread);
+        playStatsThreadOpen = false;
+    }
+    //Whatever finished is kept for next time. The UI is already gone, so users aren't touched.
+    for(playStatsEntry& entry : playStatsDone)
+    {
+        if(entry.fetched == 0)
+            continue;
+
+        playStatsCache[playStatsKey(util::accountUIDToU128(entry.uid), entry.tid)] = entry;
+        playStatsChanged = true;
+    }
+    playStatsDone.clear();
+    playStatsSave();
+}
+
+static inline uint64_t getSaveTID(const FsSaveDataInfo& _inf)
+{
+    if(_inf.save_data_type == FsSaveDataType_System || _inf.save_data_type == FsSaveDataType_SystemBcat)
+        return _inf.system_save_data_id;
+
+    return _inf.application_id;
+}
+
+//Sorts a save into the user it belongs to. Returns the user's index or -1 if it's skipped.
+//Users are only created if _addUsers is set. Otherwise -2 is returned when one is needed.
+static int addSaveToUser(FsSaveDataInfo& info, bool _addUsers)
+{
+    uint64_t tid = getSaveTID(info);
+
+    //Don't bother with this stuff
+    if(cfg::isBlacklisted(tid) || !accountSystemSaveCheck(info) || !testMount(info))
+        return -1;
+
+    switch(info.save_data_type)
+    {
+        case FsSaveDataType_Bcat:
+            info.uid = util::u128ToAccountUID(2);
+            break;
+
+        case FsSaveDataType_Device:
+            info.uid = util::u128ToAccountUID(3);
+            break;
+
+        case FsSaveDataType_SystemBcat:
+            info.uid = util::u128ToAccountUID(4);
+            if(!sysBCATPushed)
+            {
+                if(!_addUsers)
+                    return -2;
+
+                ++systemUserCount;
+                sysBCATPushed = true;
+                data::users.emplace_back(util::u128ToAccountUID(4), ui::getUIString("saveTypeMainMenu", 4), "System BCAT");
+            }
+            break;
+
+        case FsSaveDataType_Cache:
+            info.uid = util::u128ToAccountUID(5);
+            break;
+
+        case FsSaveDataType_Temporary:
+            info.uid = util::u128ToAccountUID(6);
+            if(!tempPushed)
+            {
+                if(!_addUsers)
+                    return -2;
+
+                ++systemUserCount;
+                tempPushed = true;
+                data::users.emplace_back(util::u128ToAccountUID(6), ui::getUIString("saveTypeMainMenu", 5), "Temporary");
+            }
+            break;
+    }
+
+    int u = getUserIndex(info.uid);
+    if(u == -1)
+    {
+        if(!_addUsers)
+            return -2;
+
+        data::users.emplace(data::users.end() - systemUserCount, info.uid, "", "");
+        u = getUserIndex(info.uid);
+    }
+
+    PdmPlayStatistics playStats;
+    if(info.save_data_type == FsSaveDataType_Account || info.save_data_type == FsSaveDataType_Device)
+        playStatsGet(info.application_id, info.uid, &playStats);
+    else
+        memset(&playStats, 0, sizeof(PdmPlayStatistics));
+    data::users[u].addUserTitleInfo(tid, &info, &playStats);
+    return u;
+}
+
 bool data::loadUsersTitles(bool clearUsers)
 {
-    static unsigned systemUserCount = 4;
     FsSaveDataInfoReader it;
     FsSaveDataInfo info;
     s64 total = 0;
+    //Titles with saves that aren't installed. Loaded all at once after the saves are read.
+    std::vector<uint64_t> newTitles;
+    std::unordered_set<uint64_t> newTitleSet;
 
     loadTitlesFromRecords();
     importSVIs();
@@ -256,6 +1107,10 @@ bool data::loadUsersTitles(bool clearUsers)
         users.emplace_back(util::u128ToAccountUID(0), ui::getUIString("saveTypeMainMenu", 3), "System");
     }
 
+    if(!mountCacheLoaded)
+        mountCacheLoad();
+    mountCacheSeen.clear();
+
     for(unsigned i = 0; i < 7; i++)
     {
         if(R_FAILED(fsOpenSaveDataInfoReader(&it, (FsSaveDataSpaceId)saveOrder[i])))
@@ -263,70 +1118,17 @@ bool data::loadUsersTitles(bool clearUsers)
 
         while(R_SUCCEEDED(fsSaveDataInfoReaderRead(&it, &info, 1, &total)) && total != 0)
         {
-            uint64_t tid = 0;
-            if(info.save_data_type == FsSaveDataType_System || info.save_data_type == FsSaveDataType_SystemBcat)
-                tid = info.system_save_data_id;
-            else
-                tid = info.application_id;
-
-            if(!titleIsLoaded(tid))
-                addTitleToList(tid);
-
-            //Don't bother with this stuff
-            if(cfg::isBlacklisted(tid) || !accountSystemSaveCheck(info) || !testMount(info))
-                continue;
-
-            switch(info.save_data_type)
-            {
-                case FsSaveDataType_Bcat:
-                    info.uid = util::u128ToAccountUID(2);
-                    break;
-
-                case FsSaveDataType_Device:
-                    info.uid = util::u128ToAccountUID(3);
-                    break;
-
-                case FsSaveDataType_SystemBcat:
-                    info.uid = util::u128ToAccountUID(4);
-                    if(!sysBCATPushed)
-                    {
-                        ++systemUserCount;
-                        sysBCATPushed = true;
-                        users.emplace_back(util::u128ToAccountUID(4), ui::getUIString("saveTypeMainMenu", 4), "System BCAT");
-                    }
-                    break;
-
-                case FsSaveDataType_Cache:
-                    info.uid = util::u128ToAccountUID(5);
-                    break;
+            uint64_t tid = getSaveTID(info);
+            if(!titleIsLoaded(tid) && newTitleSet.insert(tid).second)
+                newTitles.push_back(tid);
 
-                case FsSaveDataType_Temporary:
-                    info.uid = util::u128ToAccountUID(6);
-                    if(!tempPushed)
-                    {
-                        ++systemUserCount;
-                        tempPushed = true;
-                        users.emplace_back(util::u128ToAccountUID(6), ui::getUIString("saveTypeMainMenu", 5), "Temporary");
-                    }
-                    break;
-            }
-
-            int u = getUserIndex(info.uid);
-            if(u == -1)
-            {
-                users.emplace(data::users.end() - systemUserCount, info.uid, "", "");
-                u = getUserIndex(info.uid);
-            }
-
-            PdmPlayStatistics playStats;
-            if(info.save_data_type == FsSaveDataType_Account || info.save_data_type == FsSaveDataType_Device)
-                pdmqryQueryPlayStatisticsByApplicationIdAndUserAccountId(info.application_id, info.uid, false, &playStats);
-            else
-                memset(&playStats, 0, sizeof(PdmPlayStatistics));
-            users[u].addUserTitleInfo(tid, &info, &playStats);
+            addSaveToUser(info, true);
         }
         fsSaveDataInfoReaderClose(&it);
     }
+    if(cfg::config["forceMount"])
+        mountCacheSave();
+    addTitlesToList(newTitles);
 
     if(cfg::config["incDev"])
     {
@@ -342,6 +1144,7 @@ bool data::loadUsersTitles(bool clearUsers)
     }
 
     data::sortUserTitles();
+    playStatsStart();
 
     return true;
 }
@@ -353,6 +1156,119 @@ void data::sortUserTitles()
         std::sort(u.titleInfo.begin(), u.titleInfo.end(), sortTitles);
 }
 
+static void addChangedUser(std::vector<unsigned>& _changed, unsigned _user)
+{
+    if(std::find(_changed.begin(), _changed.end(), _user) == _changed.end())
+        _changed.push_back(_user);
+}
+
+static std::vector<unsigned> allUsers()
+{
+    std::vector<unsigned> ret;
+    for(unsigned i = 0; i < data::users.size(); i++)
+        ret.push_back(i);
+    return ret;
+}
+
+std::vector<unsigned> data::removeTitleSaves(const uint64_t& tid)
+{
+    std::vector<unsigned> changed;
+    for(unsigned i = 0; i < data::users.size(); i++)
+    {
+        std::vector<data::userTitleInfo>& titles = data::users[i].titleInfo;
+        auto rem = std::remove_if(titles.begin(), titles.end(), [&tid](const data::userTitleInfo& t){ return t.tid == tid; });
+        if(rem != titles.end())
+        {
+            titles.erase(rem, titles.end());
+            addChangedUser(changed, i);
+        }
+    }
+    return changed;
+}
+
+std::vector<unsigned> data::removeSave(const uint64_t& saveID)
+{
+    //Device saves can be in every account user's list with incDev
+    std::vector<unsigned> changed;
+    for(unsigned i = 0; i < data::users.size(); i++)
+    {
+        std::vector<data::userTitleInfo>& titles = data::users[i].titleInfo;
+        auto rem = std::remove_if(titles.begin(), titles.end(), [&saveID](const data::userTitleInfo& t){ return t.saveInfo.save_data_id == saveID; });
+        if(rem != titles.end())
+        {
+            titles.erase(rem, titles.end());
+            addChangedUser(changed, i);
+        }
+    }
+    return changed;
+}
+
+std::vector<unsigned> data::reloadTitleSaves(const uint64_t& tid)
+{
+    //Could be an application or a system save
+    FsSaveDataFilter filters[2];
+    memset(filters, 0, sizeof(filters));
+    filters[0].filter_by_application_id = true;
+    filters[0].attr.application_id = tid;
+    filters[1].filter_by_system_save_data_id = true;
+    filters[1].attr.system_save_data_id = tid;
+
+    std::vector<FsSaveDataInfo> saves;
+    std::unordered_set<uint64_t> found;
+    for(unsigned i = 0; i < 7; i++)
+    {
+        for(FsSaveDataFilter& filter : filters)
+        {
+            FsSaveDataInfoReader it;
+            FsSaveDataInfo info;
+            s64 total = 0;
+            if(R_FAILED(fsOpenSaveDataInfoReaderWithFilter(&it, (FsSaveDataSpaceId)saveOrder[i], &filter)))
+                continue;
+
+            while(R_SUCCEEDED(fsSaveDataInfoReaderRead(&it, &info, 1, &total)) && total != 0)
+            {
+                if(getSaveTID(info) == tid && found.insert(info.save_data_id).second)
+                    saves.push_back(info);
+            }
+            fsSaveDataInfoReaderClose(&it);
+        }
+    }
+
+    std::vector<unsigned> changed = data::removeTitleSaves(tid);
+    if(!saves.empty() && !titleIsLoaded(tid))
+        addTitlesToList({ tid });
+
+    unsigned devPos = getUserIndex(util::u128ToAccountUID(3));
+    for(FsSaveDataInfo& info : saves)
+    {
+        int u = addSaveToUser(info, false);
+        if(u == -2)
+        {
+            //Needs a user that isn't there yet. Let the full reload sort it out.
+            data::loadUsersTitles(false);
+            return allUsers();
+        }
+        else if(u < 0)
+            continue;
+
+        addChangedUser(changed, u);
+        if(cfg::config["incDev"] && (unsigned)u == devPos)
+        {
+            for(unsigned i = 0; i < devPos; i++)
+            {
+                data::users[i].titleInfo.push_back(data::users[devPos].titleInfo.back());
+                addChangedUser(changed, i);
+            }
+        }
+    }
+
+    for(unsigned u : changed)
+        std::sort(data::users[u].titleInfo.begin(), data::users[u].titleInfo.end(), sortTitles);
+
+    playStatsStart();
+    return changed;
+}
+
 void data::init()
 {
     data::loadUsersTitles(true);
@@ -360,7 +1276,16 @@ void data::init()
 
 void data::exit()
 {
-    /*Still needed for planned future revisions*/
+    iconStopLoader();
+    playStatsExit();
+}
+
+void data::update()
+{
+    iconUpdate();
+    //Tasks like creating or deleting saves change users from their own thread
+    if(ui::foregroundIdle())
+        playStatsUpdate();
 }
 
 void data::setUserIndex(unsigned _sUser)
@@ -412,7 +1337,78 @@ std::string data::getTitleSafeNameByTID(const uint64_t& tid)
 
 SDL_Texture *data::getTitleIconByTID(const uint64_t& tid)
 {
-    return titles[tid].icon;
+    if(!iconPlaceholder)
+        iconPlaceholder = util::createIconGeneric("", 32, true);
+
+    auto title = titles.find(tid);
+    if(title == titles.end())
+        return iconPlaceholder;
+
+    if(title->second.icon)
+    {
+        auto use = iconLRUPos.find(tid);
+        if(use != iconLRUPos.end())
+        {
+            use->second->lastDrawn = iconFrame;
+            iconLRU.splice(iconLRU.begin(), iconLRU, use->second);
+        }
+        return title->second.icon;
+    }
+
+    if(iconPending.find(tid) == iconPending.end())
+        iconRequestLoad(tid, title->second);
+
+    return iconPlaceholder;
+}
+
+static void iconUpdate()
+{
+    std::vector<iconResult> done;
+    mutexLock(&iconLock);
+    unsigned take = iconResults.size() < ICON_UPLOADS_PER_FRAME ? iconResults.size() : ICON_UPLOADS_PER_FRAME;
+    done.assign(iconResults.begin(), iconResults.begin() + take);
+    iconResults.erase(iconResults.begin(), iconResults.begin() + take);
+    for(iconResult& res : done)
+        iconPending.erase(res.tid);
+    mutexUnlock(&iconLock);
+
+    for(iconResult& res : done)
+    {
+        auto title = titles.find(res.tid);
+        if(title == titles.end() || title->second.icon)
+        {
+            if(res.icon)
+                SDL_FreeSurface(res.icon);
+            continue;
+        }
+
+        SDL_Texture *icon = gfx::texMgr->textureLoadFromSurface(res.icon);
+        if(!icon)
+            icon = util::createIconGeneric(util::getIDStrLower(res.tid).c_str(), 32, true);
+
+        int w = 0, h = 0;
+        SDL_QueryTexture(icon, NULL, NULL, &w, &h);
+        title->second.icon = icon;
+        iconLRU.push_front({ res.tid, iconFrame, (size_t)w * h * 4 });
+        iconLRUPos[res.tid] = iconLRU.begin();
+        iconBytes += iconLRU.front().size;
+    }
+
+    //Nothing drawn last frame is freed, even over budget
+    while(iconBytes > ICON_TEXTURE_BUDGET && !iconLRU.empty() && iconLRU.back().lastDrawn + 1 < iconFrame)
+    {
+        iconUse& use = iconLRU.back();
+        auto title = titles.find(use.tid);
+        if(title != titles.end() && title->second.icon)
+        {
+            gfx::texMgr->textureDestroy(title->second.icon);
+            title->second.icon = NULL;
+        }
+        iconBytes -= use.size;
+        iconLRUPos.erase(use.tid);
+        iconLRU.pop_back();
+    }
+    iconFrame++;
 }
 
 int data::getTitleIndexInUser(const data::user& u, const uint64_t& tid)
@@ -1,5 +1,9 @@
 #include <switch.h>
 #include <string>
+#include <algorithm>
+#include <unordered_map>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "fs.h"
 #include "cfg.h"
@@ -7,6 +11,9 @@
 
 static std::string wd = "sdmc:/JKSV/";
 
+//Relative to wd
+#define TRASH_TIMES_FILE "_TRASH_/trashTimes.txt"
+
 static FSFILE *debLog;
 
 static FsFileSystem sv;
@@ -218,8 +225,7 @@ void fs::createSaveData(FsSaveDataType _type, uint64_t _tid, AccountUid _uid, th
     if(R_SUCCEEDED(res = fsCreateSaveDataFileSystem(&attr, &crt, &meta)))
     {
         util::createTitleDirectoryByTID(_tid);
-        data::loadUsersTitles(false);
-        ui::ttlRefresh();
+        ui::ttlRefresh(data::reloadTitleSaves(_tid));
     }
     else
     {
@@ -421,15 +427,16 @@ void fs::createNewBackup(void *a)
             if(ext != "zip")//data::zip is on but extension is not zip
                 path += ".zip";
 
+            fs::remoteQueueRelease(path);
             zipFile zip = zipOpen64(path.c_str(), 0);
-            fs::copyDirToZipThreaded("sv:/", zip, false, 0);
-
+            //Copy thread queues the upload itself once the backup is complete
+            fs::copyDirToZipThreaded("sv:/", zip, false, 0, d->tid, path);
         }
         else
         {
+            fs::remoteQueueRelease(path);
             fs::mkDir(path);
-            path += "/";
-            fs::copyDirToDirThreaded("sv:/", path);
+            fs::copyDirToDirThreaded("sv:/", path + "/", d->tid, path);
         }
         ui::fldRefreshMenu();
     }
@@ -440,6 +447,7 @@ void fs::overwriteBackup(void *a)
     threadInfo *t = (threadInfo *)a;
     std::string *dst = (std::string *)t->argPtr;
     bool saveHasFiles = fs::dirNotEmpty("sv:/");
+    fs::remoteQueueRelease(*dst);
     if(fs::isDir(*dst) && saveHasFiles)
     {
         fs::delDir(*dst);
@@ -490,7 +498,7 @@ void fs::restoreBackup(void *a)
                 int64_t  availSize = 0;
                 fs::getDirProps(*restore, dirCount, fileCount, saveSize);
                 fsFsGetTotalSpace(fsdevGetDeviceFileSystem("sv"), "/", &availSize);
-                if((int)saveSize > availSize)
+                if(saveSize > (uint64_t)availSize)
                 {
                     data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
                     fs::unmountSave();
@@ -513,7 +521,7 @@ void fs::restoreBackup(void *a)
                 uint64_t saveSize = fs::getZipTotalSize(unz);
                 int64_t  availSize  = 0;
                 fsFsGetTotalSpace(fsdevGetDeviceFileSystem("sv"), "/", &availSize);
-                if((int)saveSize > availSize)
+                if(saveSize > (uint64_t)availSize)
                 {
                     data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
                     fs::unmountSave();
@@ -543,6 +551,41 @@ void fs::restoreBackup(void *a)
     t->finished = true;
 }
 
+//Guards _TRASH_, its times and the purge flags so purging, moving to and emptying the trash don't run over each other
+static Mutex trashLock = 0;
+static bool trashPurgeRunning = false, trashPurgeRerun = false;
+
+//rename keeps the backup's mtime, so when each entry was trashed is kept here instead. Keyed by "<title>/<backup>"
+static std::unordered_map<std::string, time_t> trashTimesLoad()
+{
+    std::unordered_map<std::string, time_t> ret;
+    FILE *timesIn = fopen(std::string(wd + TRASH_TIMES_FILE).c_str(), "r");
+    if(!timesIn)
+        return ret;
+
+    char line[0x400], name[0x300];
+    long long trashed = 0;
+    while(fgets(line, 0x400, timesIn))
+    {
+        if(sscanf(line, "%lld\t%767[^\n]", &trashed, name) == 2)
+            ret[name] = (time_t)trashed;
+    }
+    fclose(timesIn);
+    return ret;
+}
+
+static void trashTimesSave(const std::unordered_map<std::string, time_t>& _times)
+{
+    FILE *timesOut = fopen(std::string(wd + TRASH_TIMES_FILE).c_str(), "w");
+    if(!timesOut)
+        return;
+
+    for(const auto& t : _times)
+        fprintf(timesOut, "%lld\t%s\n", (long long)t.second, t.first.c_str());
+
+    fclose(timesOut);
+}
+
 void fs::deleteBackup(void *a)
 {
     threadInfo *t = (threadInfo *)a;
@@ -551,15 +594,25 @@ void fs::deleteBackup(void *a)
 
     t->status->setStatus(ui::getUICString("threadStatusDeletingFile", 0));
     data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
+    fs::remoteQueueRelease(*deletePath);
     if(cfg::config["trashBin"])
     {
         std::string oldPath = *deletePath;
+        std::string trashName = data::getTitleSafeNameByTID(utinfo->tid) + "/" + backupName;
         std::string trashPath = wd + "_TRASH_/" + data::getTitleSafeNameByTID(utinfo->tid);
+
+        mutexLock(&trashLock);
         fs::mkDir(trashPath);
         trashPath += "/" + backupName;
-
-        rename(oldPath.c_str(), trashPath.c_str());
+        if(rename(oldPath.c_str(), trashPath.c_str()) == 0)
+        {
+            std::unordered_map<std::string, time_t> trashTimes = trashTimesLoad();
+            trashTimes[trashName] = time(NULL);
+            trashTimesSave(trashTimes);
+        }
+        mutexUnlock(&trashLock);
         ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("saveDataBackupMovedToTrash", 0), backupName.c_str());
+        fs::trashPurgeThreaded();
     }
     else if(fs::isDir(*deletePath))
     {
@@ -577,6 +630,183 @@ void fs::deleteBackup(void *a)
     t->finished = true;
 }
 
+typedef struct
+{
+    std::string path, name;
+    bool isDir;
+    uint64_t size;
+    time_t trashed;
+} trashEntry;
+
+//Entries being purged are moved here first so the lock isn't held while they're deleted. Top level, so scans skip them.
+#define TRASH_PURGE_PREFIX ".purge_"
+
+static void trashPurge_t(void *a)
+{
+    threadInfo *t = (threadInfo *)a;
+    std::string trashDir = wd + "_TRASH_/";
+    unsigned purgeCount = 0;
+    bool rerun = false;
+    do
+    {
+        //Only the listing and times are taken under the lock. Sizes and deleting happen without it.
+        t->status->setStatus(ui::getUICString("threadStatusScanningTrash", 0));
+        std::vector<trashEntry> entries;
+        std::vector<std::string> leftovers;
+        mutexLock(&trashLock);
+        trashPurgeRerun = false;
+        std::unordered_map<std::string, time_t> trashTimes = trashTimesLoad();
+        fs::dirList titleList(trashDir);
+        for(unsigned i = 0; i < titleList.getCount(); i++)
+        {
+            std::string titleName = titleList.getItem(i);
+            //Only one purge runs at a time, so any of these are from one that didn't get to finish
+            if(titleName.find(TRASH_PURGE_PREFIX) == 0)
+            {
+                leftovers.push_back(trashDir + titleName);
+                continue;
+            }
+
+            if(!titleList.isDir(i))
+                continue;
+
+            std::string titleDir = trashDir + titleName + "/";
+            fs::dirList backupList(titleDir);
+            for(unsigned j = 0; j < backupList.getCount(); j++)
+            {
+                trashEntry ent;
+                ent.name = titleName + "/" + backupList.getItem(j);
+                ent.path = titleDir + backupList.getItem(j);
+                ent.isDir = backupList.isDir(j);
+                ent.size = 0;
+                ent.trashed = 0;
+
+                //Trashed before times were kept. mtime is the best there is for these
+                auto findTime = trashTimes.find(ent.name);
+                struct stat s;
+                if(findTime != trashTimes.end())
+                    ent.trashed = findTime->second;
+                else if(stat(ent.path.c_str(), &s) == 0)
+                    ent.trashed = s.st_mtime;
+
+                entries.push_back(ent);
+            }
+        }
+        mutexUnlock(&trashLock);
+
+        for(const std::string& l : leftovers)
+        {
+            if(fs::isDir(l))
+                fsDelDirRec(std::string(l + "/").c_str());
+            else
+                fs::delfile(l);
+        }
+
+        uint64_t trashSize = 0;
+        for(trashEntry& ent : entries)
+        {
+            if(ent.isDir)
+            {
+                unsigned dirCount = 0, fileCount = 0;
+                fs::getDirProps(ent.path + "/", dirCount, fileCount, ent.size);
+            }
+            else
+                ent.size = fs::fsize(ent.path);
+
+            trashSize += ent.size;
+        }
+
+        //Oldest first
+        std::sort(entries.begin(), entries.end(), [](const trashEntry& a, const trashEntry& b) { return a.trashed < b.trashed; });
+
+        uint64_t maxSize = (uint64_t)cfg::trashMaxSizeMB * 0x100000;
+        time_t maxAge = (time_t)cfg::trashMaxAgeDays * 86400, now = time(NULL);
+        for(unsigned i = 0; i < entries.size(); i++)
+        {
+            trashEntry& ent = entries[i];
+            bool tooBig = maxSize > 0 && trashSize > maxSize;
+            bool tooOld = maxAge > 0 && now - ent.trashed > maxAge;
+            if(!tooBig && !tooOld)
+                break;
+
+            trashSize -= ent.size;
+
+            //Emptied, or replaced by a newer backup with the same name since the scan. Either way it isn't what was measured.
+            std::string purgePath = trashDir + TRASH_PURGE_PREFIX + std::to_string(purgeCount++);
+            mutexLock(&trashLock);
+            std::unordered_map<std::string, time_t> trashTimes = trashTimesLoad();
+            auto findTime = trashTimes.find(ent.name);
+            bool same = findTime == trashTimes.end() || findTime->second == ent.trashed;
+            bool moved = same && rename(ent.path.c_str(), purgePath.c_str()) == 0;
+            if(moved && findTime != trashTimes.end())
+            {
+                trashTimes.erase(findTime);
+                trashTimesSave(trashTimes);
+            }
+            mutexUnlock(&trashLock);
+
+            if(!moved)
+                continue;
+
+            t->status->setStatus(ui::getUICString("threadStatusPurgingTrash", 0), util::getFilenameFromPath(ent.path).c_str(), i + 1, (unsigned)entries.size());
+            if(ent.isDir)
+                fsDelDirRec(std::string(purgePath + "/").c_str());
+            else
+                fs::delfile(purgePath);
+        }
+
+        mutexLock(&trashLock);
+        //Times for anything that isn't in the trash anymore are dropped
+        std::unordered_map<std::string, time_t> trashTimes = trashTimesLoad(), keptTimes;
+        for(const auto& trashTime : trashTimes)
+        {
+            struct stat s;
+            if(stat(std::string(trashDir + trashTime.first).c_str(), &s) == 0)
+                keptTimes.insert(trashTime);
+        }
+        if(keptTimes.size() != trashTimes.size())
+            trashTimesSave(keptTimes);
+
+        //Clear out title folders left empty
+        for(unsigned i = 0; i < titleList.getCount(); i++)
+        {
+            std::string titleDir = trashDir + titleList.getItem(i) + "/";
+            if(titleList.isDir(i) && !fs::dirNotEmpty(titleDir))
+                rmdir(titleDir.c_str());
+        }
+
+        rerun = trashPurgeRerun;
+        if(!rerun)
+            trashPurgeRunning = false;
+        mutexUnlock(&trashLock);
+    } while(rerun);
+
+    t->finished = true;
+}
+
+void fs::trashPurgeThreaded()
+{
+    if(cfg::trashMaxSizeMB == 0 && cfg::trashMaxAgeDays == 0)
+        return;
+
+    mutexLock(&trashLock);
+    //Already going. Just have it take another pass when it's done
+    if(trashPurgeRunning)
+        trashPurgeRerun = true;
+    else
+        trashPurgeRunning = ui::newBackgroundThread(trashPurge_t, NULL) != NULL;
+    mutexUnlock(&trashLock);
+}
+
+void fs::trashEmpty()
+{
+    //Waits out a purge pass that's running
+    mutexLock(&trashLock);
+    fs::delDir(wd + "_TRASH_/");
+    mkdir(std::string(wd + "_TRASH_").c_str(), 777);
+    mutexUnlock(&trashLock);
+}
+
 void fs::dumpAllUserSaves(void *a)
 {
     threadInfo *t = (threadInfo *)a;
@@ -596,6 +826,7 @@ void fs::dumpAllUserSaves(void *a)
             fs::copyDirToZip("sv:/", zip, false, 0, t);
             zipClose(zip, NULL);
             fs::freePathFilters();
+            fs::remoteQueueAdd(u->titleInfo[i].tid, dst);
         }
         else if(saveMounted && fs::dirNotEmpty("sv:/"))
         {
@@ -604,6 +835,7 @@ void fs::dumpAllUserSaves(void *a)
             fs::mkDir(dst.substr(0, dst.length() - 1));
             fs::copyDirToDir("sv:/", dst, t);
             fs::freePathFilters();
+            fs::remoteQueueAdd(u->titleInfo[i].tid, dst.substr(0, dst.length() - 1));
         }
         fs::unmountSave();
     }
@@ -632,6 +864,7 @@ void fs::dumpAllUsersAllSaves(void *a)
                 fs::copyDirToZip("sv:/", zip, false, 0, t);
                 zipClose(zip, NULL);
                 fs::freePathFilters();
+                fs::remoteQueueAdd(u->titleInfo[i].tid, dst);
             }
             else if(saveMounted && fs::dirNotEmpty("sv:/"))
             {
@@ -640,6 +873,7 @@ void fs::dumpAllUsersAllSaves(void *a)
                 fs::mkDir(dst.substr(0, dst.length() - 1));
                 fs::copyDirToDir("sv:/", dst, t);
                 fs::freePathFilters();
+                fs::remoteQueueAdd(u->titleInfo[i].tid, dst.substr(0, dst.length() - 1));
             }
             fs::unmountSave();
         }
@@ -0,0 +1,459 @@
+#include <switch.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <unordered_map>
+
+#include "fs.h"
+#include "cfg.h"
+#include "util.h"
+#include "ui.h"
+
+//Chunk sizes. A boundary is only looked for between min and max
+#define CHUNK_MIN_SIZE 0x40000
+#define CHUNK_MAX_SIZE 0x400000
+//Top 20 bits of the gear hash need to be 0 for a boundary, so ~1MB past the minimum on average
+#define CHUNK_BOUNDARY_MASK 0xFFFFF00000000000ULL
+#define CHUNK_READ_SIZE 0x100000
+#define CHUNK_MANIFEST_HEADER "JKSV_CHUNKS 1"
+//How much is downloaded before it's written out when putting a file back together. Bounds the extra SD space a download needs.
+#define CHUNK_DOWNLOAD_WINDOW 0x2000000
+
+typedef struct
+{
+    std::string hash;
+    uint64_t size;
+} chunkEntry;
+
+static uint64_t gearTable[256];
+static bool gearTableReady = false;
+
+//Every call gets its own temp folder so two running at once don't delete each other's chunks
+static Mutex tmpDirLock = 0;
+static unsigned tmpDirNext = 0;
+
+//Uploads hold this for reading. Collecting unused chunks holds it for writing, so chunks that were sent but don't have a manifest yet aren't removed.
+//Zeroed is the same as rwlockInit.
+static RwLock chunkCollectLock;
+
+//Table has to be the same on every system or chunks won't line up between them, so it's generated from a fixed seed instead of randomly
+static void gearTableInit()
+{
+    if(gearTableReady)
+        return;
+
+    uint64_t seed = 0x4A4B5356;
+    for(unsigned i = 0; i < 256; i++)
+    {
+        //splitmix64
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        gearTable[i] = z ^ (z >> 31);
+    }
+    gearTableReady = true;
+}
+
+static std::string getTmpDir()
+{
+    mutexLock(&tmpDirLock);
+    unsigned id = tmpDirNext++;
+    mutexUnlock(&tmpDirLock);
+
+    char tmpDir[32];
+    snprintf(tmpDir, 32, "_CHUNKS_TMP_%u/", id);
+    return fs::getWorkDir() + tmpDir;
+}
+
+static std::string getChunkDirID()
+{
+    if(!fs::rfs->dirExists(JKSV_CHUNK_FOLDER, fs::rfsRootID))
+        fs::rfs->createDir(JKSV_CHUNK_FOLDER, fs::rfsRootID);
+
+    return fs::rfs->getDirID(JKSV_CHUNK_FOLDER, fs::rfsRootID);
+}
+
+static std::string hashBuffer(const uint8_t *_data, size_t _size)
+{
+    Sha256Context ctx;
+    sha256ContextCreate(&ctx);
+    sha256ContextUpdate(&ctx, _data, _size);
+    return rfs::sha256ToString(&ctx);
+}
+
+//Writes chunks that aren't in _skip to _tmpDir and adds them to _newChunks
+static bool chunkFile(const std::string& _path, const std::string& _tmpDir, const std::unordered_set<std::string>& _skip, std::vector<chunkEntry>& _entries, std::vector<std::string>& _newChunks, std::string& _fileHash)
+{
+    FILE *in = fopen(_path.c_str(), "rb");
+    if(!in)
+        return false;
+
+    gearTableInit();
+
+    Sha256Context fileCtx;
+    sha256ContextCreate(&fileCtx);
+
+    std::unordered_set<std::string> written;
+    std::vector<uint8_t> readBuffer(CHUNK_READ_SIZE), chunk;
+    chunk.reserve(CHUNK_MAX_SIZE);
+
+    bool ok = true;
+    auto endChunk = [&]()
+    {
+        chunkEntry entry = { hashBuffer(chunk.data(), chunk.size()), chunk.size() };
+        if(_skip.find(entry.hash) == _skip.end() && written.insert(entry.hash).second)
+        {
+            FILE *out = fopen(std::string(_tmpDir + entry.hash).c_str(), "wb");
+            ok = out && fwrite(chunk.data(), 1, chunk.size(), out) == chunk.size();
+            if(out)
+                fclose(out);
+
+            _newChunks.push_back(entry.hash);
+        }
+        _entries.push_back(entry);
+        chunk.clear();
+    };
+
+    uint64_t gear = 0;
+    size_t readIn = 0;
+    while(ok && (readIn = fread(readBuffer.data(), 1, CHUNK_READ_SIZE, in)) > 0)
+    {
+        sha256ContextUpdate(&fileCtx, readBuffer.data(), readIn);
+        for(size_t i = 0; i < readIn; i++)
+        {
+            chunk.push_back(readBuffer[i]);
+            gear = (gear << 1) + gearTable[readBuffer[i]];
+            if(chunk.size() >= CHUNK_MAX_SIZE || (chunk.size() >= CHUNK_MIN_SIZE && (gear & CHUNK_BOUNDARY_MASK) == 0))
+            {
+                endChunk();
+                gear = 0;
+            }
+        }
+    }
+
+    if(ok && !chunk.empty())
+        endChunk();
+    fclose(in);
+
+    _fileHash = rfs::sha256ToString(&fileCtx);
+    return ok;
+}
+
+static bool writeManifest(const std::string& _path, const std::vector<chunkEntry>& _entries, uint64_t _size, const std::string& _fileHash)
+{
+    FILE *out = fopen(_path.c_str(), "w");
+    if(!out)
+        return false;
+
+    fprintf(out, "%s\n", CHUNK_MANIFEST_HEADER);
+    fprintf(out, "file %llu %s\n", (unsigned long long)_size, _fileHash.c_str());
+    for(const chunkEntry& e : _entries)
+        fprintf(out, "%s %llu\n", e.hash.c_str(), (unsigned long long)e.size);
+
+    fclose(out);
+    return true;
+}
+
+static bool readManifest(const std::string& _path, std::vector<chunkEntry>& _entries, uint64_t& _size, std::string& _fileHash)
+{
+    FILE *in = fopen(_path.c_str(), "r");
+    if(!in)
+        return false;
+
+    char line[256], hash[80];
+    unsigned long long size = 0;
+    bool ok = fgets(line, 256, in) && std::string(line).find(CHUNK_MANIFEST_HEADER) == 0;
+    if(ok && fgets(line, 256, in) && sscanf(line, "file %llu %79s", &size, hash) == 2)
+    {
+        _size = size;
+        _fileHash = hash;
+    }
+    else
+        ok = false;
+
+    while(ok && fgets(line, 256, in))
+    {
+        if(sscanf(line, "%79s %llu", hash, &size) == 2)
+            _entries.push_back({ hash, (uint64_t)size });
+    }
+    fclose(in);
+    return ok;
+}
+
+//transferMngr::run wants copyArgs in argPtr. Whatever the caller had there is put back after.
+static void runTransfers(rfs::transferMngr& _transfers, threadInfo *t)
+{
+    if(!t)
+    {
+        _transfers.run(NULL);
+        return;
+    }
+
+    void *oldArgs = t->argPtr;
+    funcPtr oldDraw = t->drawFunc;
+    fs::copyArgs *cpyArgs = fs::copyArgsCreate("", "", "", NULL, NULL, false, false, 0);
+    t->argPtr = cpyArgs;
+    t->drawFunc = fs::fileDrawFunc;
+    _transfers.run(t);
+    t->drawFunc = oldDraw;
+    t->argPtr = oldArgs;
+    fs::copyArgsDestroy(cpyArgs);
+}
+
+bool fs::chunkUpload(const std::string& _localPath, const std::string& _filename, const std::string& _parent, threadInfo *t)
+{
+    rwlockReadLock(&chunkCollectLock);
+    std::string chunkDir = getChunkDirID();
+    std::string tmpDir = getTmpDir();
+    fs::mkDir(tmpDir.substr(0, tmpDir.length() - 1));
+
+    std::unordered_set<std::string> remoteHas;
+    std::vector<rfs::RfsItem> remoteChunks = fs::rfs->getListWithParent(chunkDir);
+    for(const rfs::RfsItem& r : remoteChunks)
+    {
+        if(!r.isDir)
+            remoteHas.insert(r.name);
+    }
+
+    if(t)
+        t->status->setStatus(ui::getUICString("threadStatusSplittingChunks", 0), _filename.c_str());
+
+    std::vector<chunkEntry> entries;
+    std::vector<std::string> newChunks;
+    std::string fileHash;
+    if(!chunkFile(_localPath, tmpDir, remoteHas, entries, newChunks, fileHash))
+    {
+        fs::logWrite("chunkUpload: Failed to split %s.\n", _localPath.c_str());
+        fs::delDir(tmpDir);
+        rwlockReadUnlock(&chunkCollectLock);
+        return false;
+    }
+    fs::logWrite("chunkUpload: %s is %u chunks, %u new.\n", _filename.c_str(), (unsigned)entries.size(), (unsigned)newChunks.size());
+
+    rfs::transferMngr transfers(fs::rfs, cfg::remoteMaxTransfers, (uint64_t)cfg::remoteMaxKBps * 1024);
+    for(const std::string& c : newChunks)
+        transfers.addUpload(tmpDir + c, c, chunkDir, "");
+
+    runTransfers(transfers, t);
+
+    //Manifest is only sent once every chunk it points to is there
+    bool ok = transfers.getFailedCount() == 0;
+    if(ok)
+    {
+        std::string manifestName = _filename + CHUNK_MANIFEST_EXT;
+        std::string manifestPath = tmpDir + manifestName;
+        ok = writeManifest(manifestPath, entries, fs::fsize(_localPath), fileHash);
+
+        std::string manifestID = fs::rfs->fileExists(manifestName, _parent) ? fs::rfs->getFileID(manifestName, _parent) : "";
+        if(ok && !fs::rfs->remoteMatches(manifestPath, manifestID))
+        {
+            //Sent through transfers too so a failed upload is reported instead of the backup looking done
+            rfs::transferMngr manifestTransfer(fs::rfs, 1, (uint64_t)cfg::remoteMaxKBps * 1024);
+            manifestTransfer.addUpload(manifestPath, manifestName, _parent, manifestID);
+            runTransfers(manifestTransfer, t);
+            ok = manifestTransfer.getFailedCount() == 0;
+            if(!ok)
+                fs::logWrite("chunkUpload: Failed to upload manifest %s.\n", manifestName.c_str());
+        }
+    }
+    fs::delDir(tmpDir);
+    rwlockReadUnlock(&chunkCollectLock);
+
+    return ok;
+}
+
+bool fs::chunkDownload(const rfs::RfsItem& _manifest, const std::string& _outPath, threadInfo *t)
+{
+    std::string tmpDir = getTmpDir();
+    fs::mkDir(tmpDir.substr(0, tmpDir.length() - 1));
+
+    std::string manifestPath = tmpDir + "manifest";
+    curlFuncs::curlDlArgs dlManifest;
+    dlManifest.path = manifestPath;
+    dlManifest.size = _manifest.size;
+    dlManifest.o = NULL;
+
+    std::vector<chunkEntry> entries;
+    uint64_t fileSize = 0;
+    std::string fileHash;
+    if(!fs::rfs->downloadFile(_manifest.id, &dlManifest) || !readManifest(manifestPath, entries, fileSize, fileHash))
+    {
+        fs::logWrite("chunkDownload: Failed to get manifest %s.\n", _manifest.name.c_str());
+        fs::delDir(tmpDir);
+        return false;
+    }
+
+    //Everything is looked up first so a missing chunk fails before anything is downloaded.
+    //The same chunk can show up more than once, so each one is kept until its last use.
+    std::string chunkDir = getChunkDirID();
+    std::unordered_map<std::string, std::string> chunkIDs;
+    std::unordered_map<std::string, unsigned> usesLeft;
+    for(const chunkEntry& e : entries)
+    {
+        if(usesLeft[e.hash]++ > 0)
+            continue;
+
+        std::string chunkID = fs::rfs->getFileID(e.hash, chunkDir);
+        if(chunkID.empty())
+        {
+            fs::logWrite("chunkDownload: Chunk %s is missing from the remote.\n", e.hash.c_str());
+            fs::delDir(tmpDir);
+            return false;
+        }
+        chunkIDs[e.hash] = chunkID;
+    }
+
+    FILE *out = fopen(_outPath.c_str(), "wb");
+    bool ok = out != NULL;
+    Sha256Context fileCtx;
+    sha256ContextCreate(&fileCtx);
+    std::unordered_set<std::string> onSD;
+    std::vector<uint8_t> chunk;
+
+    //Chunks are downloaded a window at a time and written out in manifest order, so the SD only needs room for about one window on top of the file
+    unsigned next = 0;
+    while(ok && next < entries.size())
+    {
+        unsigned windowEnd = next;
+        uint64_t windowSize = 0;
+        rfs::transferMngr transfers(fs::rfs, cfg::remoteMaxTransfers, (uint64_t)cfg::remoteMaxKBps * 1024);
+        for(; windowEnd < entries.size() && (windowEnd == next || windowSize < CHUNK_DOWNLOAD_WINDOW); windowEnd++)
+        {
+            const chunkEntry& e = entries[windowEnd];
+            if(!onSD.insert(e.hash).second)
+                continue;
+
+            transfers.addDownload(chunkIDs[e.hash], e.hash, tmpDir + e.hash, e.size);
+            windowSize += e.size;
+        }
+
+        runTransfers(transfers, t);
+        if(transfers.getFailedCount() > 0)
+        {
+            //Partial chunks are small enough that resuming them isn't worth it
+            ok = false;
+            break;
+        }
+
+        if(t)
+            t->status->setStatus(ui::getUICString("threadStatusJoiningChunks", 0), _manifest.name.c_str());
+
+        for(; ok && next < windowEnd; next++)
+        {
+            const chunkEntry& e = entries[next];
+            std::string chunkPath = tmpDir + e.hash;
+            chunk.resize(e.size);
+            FILE *in = fopen(chunkPath.c_str(), "rb");
+            ok = in && fread(chunk.data(), 1, chunk.size(), in) == chunk.size();
+            if(in)
+                fclose(in);
+
+            if(ok && hashBuffer(chunk.data(), chunk.size()) != e.hash)
+            {
+                fs::logWrite("chunkDownload: Chunk %s doesn't match its hash.\n", e.hash.c_str());
+                ok = false;
+            }
+
+            if(ok)
+            {
+                sha256ContextUpdate(&fileCtx, chunk.data(), chunk.size());
+                ok = fwrite(chunk.data(), 1, chunk.size(), out) == chunk.size();
+            }
+
+            if(--usesLeft[e.hash] == 0)
+                fs::delfile(chunkPath);
+        }
+    }
+    if(out)
+        fclose(out);
+
+    if(ok && (fs::fsize(_outPath) != fileSize || rfs::sha256ToString(&fileCtx) != fileHash))
+    {
+        fs::logWrite("chunkDownload: %s doesn't match the manifest.\n", _outPath.c_str());
+        ok = false;
+    }
+
+    if(!ok)
+        fs::delfile(_outPath);
+
+    fs::delDir(tmpDir);
+    return ok;
+}
+
+//Marks every chunk a manifest anywhere on the remote points to, then removes the rest.
+//If any manifest can't be read nothing is removed, since its chunks would look unused.
+static void chunkCollect_t(void *a)
+{
+    threadInfo *t = (threadInfo *)a;
+    t->status->setStatus(ui::getUICString("threadStatusCollectingChunks", 0));
+
+    rwlockWriteLock(&chunkCollectLock);
+    std::string tmpDir = getTmpDir();
+    fs::mkDir(tmpDir.substr(0, tmpDir.length() - 1));
+
+    std::string chunkDir = getChunkDirID();
+    std::unordered_set<std::string> used;
+    bool ok = true;
+    std::vector<rfs::RfsItem> rootList = fs::rfs->getListWithParent(fs::rfsRootID);
+    for(unsigned i = 0; ok && i < rootList.size(); i++)
+    {
+        if(!rootList[i].isDir || rootList[i].id == chunkDir)
+            continue;
+
+        std::vector<rfs::RfsItem> titleList = fs::rfs->getListWithParent(rootList[i].id);
+        for(unsigned j = 0; ok && j < titleList.size(); j++)
+        {
+            const rfs::RfsItem& item = titleList[j];
+            if(item.isDir || !fs::isChunkManifest(item.name))
+                continue;
+
+            std::string manifestPath = tmpDir + "manifest";
+            curlFuncs::curlDlArgs dlManifest;
+            dlManifest.path = manifestPath;
+            dlManifest.size = item.size;
+            dlManifest.o = NULL;
+
+            std::vector<chunkEntry> entries;
+            uint64_t fileSize = 0;
+            std::string fileHash;
+            ok = fs::rfs->downloadFile(item.id, &dlManifest) && readManifest(manifestPath, entries, fileSize, fileHash);
+            if(!ok)
+                fs::logWrite("chunkCollect: Failed to read manifest %s. Nothing was removed.\n", item.name.c_str());
+
+            for(const chunkEntry& e : entries)
+                used.insert(e.hash);
+            fs::delfile(manifestPath);
+        }
+    }
+
+    unsigned removed = 0;
+    if(ok)
+    {
+        std::vector<rfs::RfsItem> chunks = fs::rfs->getListWithParent(chunkDir);
+        for(const rfs::RfsItem& c : chunks)
+        {
+            if(c.isDir || used.find(c.name) != used.end())
+                continue;
+
+            fs::rfs->deleteFile(c.id);
+            ++removed;
+        }
+        fs::logWrite("chunkCollect: Removed %u of %u chunks.\n", removed, (unsigned)chunks.size());
+    }
+    fs::delDir(tmpDir);
+    rwlockWriteUnlock(&chunkCollectLock);
+
+    if(ok)
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popChunksRemoved", 0), removed);
+    else
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popChunksNotRemoved", 0));
+
+    t->finished = true;
+}
+
+void fs::chunkCollect()
+{
+    if(fs::rfs)
+        ui::newThread(chunkCollect_t, NULL, NULL);
+}
@@ -42,6 +42,25 @@ void fs::mkDirRec(const std::string& _p)
     }
 }
 
+void fs::mkDirRec(const std::string& _p, std::unordered_set<std::string>& _made)
+{
+    if(_made.find(_p) != _made.end())
+        return;
+
+    size_t pos = _p.find('/', 0) + 1;
+    while((pos = _p.find('/', pos)) != _p.npos)
+    {
+        std::string sub = _p.substr(0, pos);
+        if(_made.find(sub) == _made.end())
+        {
+            fs::mkDir(sub);
+            _made.insert(sub);
+        }
+        ++pos;
+    }
+    _made.insert(_p);
+}
+
 void fs::delDir(const std::string& path)
 {
     dirList list(path);
@@ -116,14 +135,18 @@ static void copyDirToDir_t(void *a)
     threadInfo *t = (threadInfo *)a;
     fs::copyArgs *in = (fs::copyArgs *)t->argPtr;
     fs::copyDirToDir(in->src, in->dst, t);
+    if(!in->uploadPath.empty())
+        fs::remoteQueueAdd(in->uploadTID, in->uploadPath);
     if(in->cleanup)
         fs::copyArgsDestroy(in);
     t->finished = true;
 }
 
-void fs::copyDirToDirThreaded(const std::string& src, const std::string& dst)
+void fs::copyDirToDirThreaded(const std::string& src, const std::string& dst, uint64_t _uploadTID, const std::string& _uploadPath)
 {
     fs::copyArgs *send = fs::copyArgsCreate(src, dst, "", NULL, NULL, true, false, 0);
+    send->uploadTID = _uploadTID;
+    send->uploadPath = _uploadPath;
     ui::newThread(copyDirToDir_t, send, fs::fileDrawFunc);
 }
 
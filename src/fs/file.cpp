@@ -24,53 +24,72 @@ typedef struct
     std::condition_variable cond;
     std::vector<uint8_t> sharedBuffer;
     std::string dst, dev;
-    bool bufferIsFull = false;
-    unsigned int filesize = 0, writeLimit = 0;
+    //Writers run until readDone instead of counting up to the size so they can't be cut short or left waiting if the source isn't the size expected
+    bool bufferIsFull = false, readDone = false;
+    uint64_t writeLimit = 0;
 } fileCpyThreadArgs;
 
+//Waits for the writer to take the last buffer and swaps _buffer in. _last lets it exit once it's written.
+static void handOffBuffer(fileCpyThreadArgs *in, std::vector<uint8_t>& _buffer, bool _last)
+{
+    std::unique_lock<std::mutex> buffLock(in->bufferLock);
+    in->cond.wait(buffLock, [in]{ return in->bufferIsFull == false; });
+    if(!_buffer.empty())
+    {
+        in->sharedBuffer.swap(_buffer);
+        _buffer.clear();
+        in->bufferIsFull = true;
+    }
+    in->readDone = _last;
+    buffLock.unlock();
+    in->cond.notify_one();
+}
+
+//Returns false once there's nothing left to write
+static bool takeBuffer(fileCpyThreadArgs *in, std::vector<uint8_t>& _localBuffer)
+{
+    std::unique_lock<std::mutex> buffLock(in->bufferLock);
+    in->cond.wait(buffLock, [in]{ return in->bufferIsFull || in->readDone; });
+    if(!in->bufferIsFull)
+        return false;
+
+    _localBuffer.swap(in->sharedBuffer);
+    in->sharedBuffer.clear();
+    in->bufferIsFull = false;
+    buffLock.unlock();
+    in->cond.notify_one();
+    return true;
+}
+
 static void writeFile_t(void *a)
 {
     fileCpyThreadArgs *in = (fileCpyThreadArgs *)a;
-    size_t written = 0;
     std::vector<uint8_t> localBuffer;
     FILE *out = fopen(in->dst.c_str(), "wb");
 
-    while(written < in->filesize)
+    while(takeBuffer(in, localBuffer))
     {
-        std::unique_lock<std::mutex> buffLock(in->bufferLock);
-        in->cond.wait(buffLock, [in]{ return in->bufferIsFull;});
-        localBuffer.clear();
-        localBuffer.assign(in->sharedBuffer.begin(), in->sharedBuffer.end());
-        in->sharedBuffer.clear();
-        in->bufferIsFull = false;
-        buffLock.unlock();
-        in->cond.notify_one();
-        written += fwrite(localBuffer.data(), 1, localBuffer.size(), out);
+        if(out)
+            fwrite(localBuffer.data(), 1, localBuffer.size(), out);
     }
-    fclose(out);
+
+    if(out)
+        fclose(out);
 }
 
 static void writeFileCommit_t(void *a)
 {
     fileCpyThreadArgs *in = (fileCpyThreadArgs *)a;
-    size_t written = 0, journalCount = 0;
+    uint64_t journalCount = 0;
     std::vector<uint8_t> localBuffer;
     FILE *out = fopen(in->dst.c_str(), "wb");
 
-    while(written < in->filesize)
+    while(takeBuffer(in, localBuffer))
     {
-        std::unique_lock<std::mutex> buffLock(in->bufferLock);
-        in->cond.wait(buffLock, [in]{ return in->bufferIsFull; });
-        localBuffer.clear();
-        localBuffer.assign(in->sharedBuffer.begin(), in->sharedBuffer.end());
-        in->sharedBuffer.clear();
-        in->bufferIsFull = false;
-        buffLock.unlock();
-        in->cond.notify_one();
-
-        written += fwrite(localBuffer.data(), 1, localBuffer.size(), out);
-
-        journalCount += written;
+        if(!out)
+            continue;
+
+        journalCount += fwrite(localBuffer.data(), 1, localBuffer.size(), out);
         if(journalCount >= in->writeLimit)
         {
             journalCount = 0;
@@ -79,7 +98,9 @@ static void writeFileCommit_t(void *a)
             out = fopen(in->dst.c_str(), "ab");
         }
     }
-    fclose(out);
+
+    if(out)
+        fclose(out);
 }
 
 fs::copyArgs *fs::copyArgsCreate(const std::string& src, const std::string& dst, const std::string& dev, zipFile z, unzFile unz, bool _cleanup, bool _trimZipPath, uint8_t _trimPlaces)
@@ -188,7 +209,7 @@ int fs::dataFile::getNextValueInt()
 void fs::copyFile(const std::string& src, const std::string& dst, threadInfo *t)
 {
     fs::copyArgs *c = NULL;
-    size_t filesize = fs::fsize(src);
+    uint64_t filesize = fs::fsize(src);
     if(t)
     {
         c = (fs::copyArgs *)t->argPtr;
@@ -206,7 +227,6 @@ void fs::copyFile(const std::string& src, const std::string& dst, threadInfo *t)
 
     fileCpyThreadArgs thrdArgs;
     thrdArgs.dst = dst;
-    thrdArgs.filesize = filesize;
 
     uint8_t *buff = new uint8_t[BUFF_SIZE];
     std::vector<uint8_t> transferBuffer;
@@ -223,17 +243,10 @@ void fs::copyFile(const std::string& src, const std::string& dst, threadInfo *t)
         if(c)
             c->offset = readCount;
 
-        if(transferBuffer.size() >= TRANSFER_BUFFER_LIMIT || readCount == filesize)
-        {
-            std::unique_lock<std::mutex> buffLock(thrdArgs.bufferLock);
-            thrdArgs.cond.wait(buffLock, [&thrdArgs]{ return thrdArgs.bufferIsFull == false; });
-            thrdArgs.sharedBuffer.assign(transferBuffer.begin(), transferBuffer.end());
-            transferBuffer.clear();
-            thrdArgs.bufferIsFull = true;
-            buffLock.unlock();
-            thrdArgs.cond.notify_one();
-        }
+        if(transferBuffer.size() >= TRANSFER_BUFFER_LIMIT)
+            handOffBuffer(&thrdArgs, transferBuffer, false);
     }
+    handOffBuffer(&thrdArgs, transferBuffer, true);
     threadWaitForExit(&writeThread);
     threadClose(&writeThread);
     fclose(fsrc);
@@ -262,7 +275,7 @@ void fs::copyFileThreaded(const std::string& src, const std::string& dst)
 void fs::copyFileCommit(const std::string& src, const std::string& dst, const std::string& dev, threadInfo *t)
 {
     fs::copyArgs *c = NULL;
-    size_t filesize = fs::fsize(src);
+    uint64_t filesize = fs::fsize(src);
     if(t)
     {
         c = (fs::copyArgs *)t->argPtr;
@@ -281,7 +294,6 @@ void fs::copyFileCommit(const std::string& src, const std::string& dst, const st
     fileCpyThreadArgs thrdArgs;
     thrdArgs.dst = dst;
     thrdArgs.dev = dev;
-    thrdArgs.filesize = filesize;
     data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
     uint64_t journalSpace = fs::getJournalSize(utinfo);
     thrdArgs.writeLimit = (journalSpace - 0x100000) < TRANSFER_BUFFER_LIMIT ? journalSpace - 0x100000 : TRANSFER_BUFFER_LIMIT;
@@ -301,17 +313,10 @@ void fs::copyFileCommit(const std::string& src, const std::string& dst, const st
         if(c)
             c->offset = readCount;
 
-        if(transferBuffer.size() >= thrdArgs.writeLimit || readCount == filesize)
-        {
-            std::unique_lock<std::mutex> buffLock(thrdArgs.bufferLock);
-            thrdArgs.cond.wait(buffLock, [&thrdArgs]{ return thrdArgs.bufferIsFull == false; });
-            thrdArgs.sharedBuffer.assign(transferBuffer.begin(), transferBuffer.end());
-            transferBuffer.clear();
-            thrdArgs.bufferIsFull = true;
-            buffLock.unlock();
-            thrdArgs.cond.notify_one();
-        }
+        if(transferBuffer.size() >= thrdArgs.writeLimit)
+            handOffBuffer(&thrdArgs, transferBuffer, false);
     }
+    handOffBuffer(&thrdArgs, transferBuffer, true);
     threadWaitForExit(&writeThread);
     threadClose(&writeThread);
 
@@ -388,8 +393,8 @@ size_t fs::fsize(const std::string& _f)
     if(get != NULL)
     {
         fseek(get, 0, SEEK_END);
-        ret = ftell(get);
+        ret = ftello(get);
+        fclose(get);
     }
-    fclose(get);
     return ret;
 }
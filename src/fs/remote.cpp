@@ -4,6 +4,8 @@
 #include "webdav.h"
 #include "cfg.h"
 #include "ui.h"
+#include "util.h"
+#include "data.h"
 
 rfs::IRemoteFS *fs::rfs = NULL;
 std::string fs::rfsRootID;
@@ -56,6 +58,7 @@ void fs::driveInit()
             cfg::saveConfig();
         }
 
+        gDrive->startTokenRefresh();
         gDrive->driveListInit("");
 
         if(!gDrive->dirExists(JKSV_DRIVE_FOLDER))
@@ -131,4 +134,142 @@ void fs::webDavInit() {
 
     rfs = webdav;
     ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popWebdavStarted", 0));
-}
\ No newline at end of file
+}
+
+static Mutex tmpPathLock = 0;
+static unsigned tmpPathNext = 0;
+
+std::string fs::remoteTmpPath(const std::string& _ext)
+{
+    mutexLock(&tmpPathLock);
+    unsigned id = tmpPathNext++;
+    mutexUnlock(&tmpPathLock);
+
+    return fs::getWorkDir() + "_UPLOAD_TMP_" + std::to_string(id) + _ext;
+}
+
+unsigned fs::remoteQueueUploads(rfs::transferMngr& _transfers, const std::string& _titlePath, const std::string& _parent, std::vector<std::string>& _tmpZips, threadInfo *t)
+{
+    unsigned skipped = 0;
+    fs::dirList backups(_titlePath);
+    for(unsigned i = 0; i < backups.getCount(); i++)
+    {
+        std::string item = backups.getItem(i), path, filename;
+        //Left over from an interrupted download or gzipped next to the backup by an older version
+        if(!backups.isDir(i) && (backups.getItemExt(i) == "part" || "." + backups.getItemExt(i) == REMOTE_GZIP_EXT))
+            continue;
+
+        if(backups.isDir(i))
+        {
+            if(t)
+                t->status->setStatus(ui::getUICString("threadStatusCompressingSaveForUpload", 0), item.c_str());
+
+            //Zipped outside the title's folder so a backup that's already named <item>.zip isn't written over
+            filename = item + ".zip";
+            path = remoteTmpPath(".zip");
+
+            int zipTrim = util::getTotalPlacesInPath(fs::getWorkDir()) + 2;
+            zipFile tmp = zipOpen64(path.c_str(), 0);
+            fs::copyDirToZip(_titlePath + item + "/", tmp, true, zipTrim, NULL);
+            zipClose(tmp, NULL);
+            _tmpZips.push_back(path);
+        }
+        else
+        {
+            filename = item;
+            path = _titlePath + filename;
+        }
+
+        //Chunked uploads only send what changed on their own, so there's nothing to queue
+        if(cfg::config["remoteChunks"])
+        {
+            chunkUpload(path, filename, _parent, t);
+            continue;
+        }
+
+        std::string sendPath = remoteCompressUpload(path, filename, t);
+        if(sendPath != path)
+            _tmpZips.push_back(sendPath);
+
+        std::string fileID = rfs->fileExists(filename, _parent) ? rfs->getFileID(filename, _parent) : "";
+        if(rfs->remoteMatches(sendPath, fileID))
+        {
+            ++skipped;
+            continue;
+        }
+        _transfers.addUpload(sendPath, filename, _parent, fileID);
+    }
+    return skipped;
+}
+
+std::string fs::remoteCompressUpload(const std::string& _path, std::string& _filename, threadInfo *t)
+{
+    //Chunks are matched by content, so they have to stay as they are
+    if(!cfg::config["remoteGzip"] || cfg::config["remoteChunks"])
+        return _path;
+
+    if(t)
+        t->status->setStatus(ui::getUICString("threadStatusCompressingSaveForUpload", 0), _filename.c_str());
+
+    std::string gzPath = remoteTmpPath(REMOTE_GZIP_EXT);
+    if(!::rfs::gzipForUpload(_path, gzPath))
+        return _path;
+
+    _filename += REMOTE_GZIP_EXT;
+    return gzPath;
+}
+
+void fs::remoteSyncAllTitles(void *a)
+{
+    threadInfo *t = (threadInfo *)a;
+    data::user *u = data::getCurrentUser();
+    unsigned skipped = 0, sent = 0, failed = 0;
+
+    if(cfg::config["ovrClk"])
+        util::sysBoost();
+
+    //One title at a time so only that title's temp zips are ever on SD at once
+    for(unsigned i = 0; i < u->titleInfo.size(); i++)
+    {
+        std::string titlePath = util::generatePathByTID(u->titleInfo[i].tid);
+        if(!fs::dirNotEmpty(titlePath))
+            continue;
+
+        data::titleInfo *tinfo = data::getTitleInfoByTID(u->titleInfo[i].tid);
+        if(!rfs->dirExists(tinfo->safeTitle, rfsRootID))
+            rfs->createDir(tinfo->safeTitle, rfsRootID);
+
+        std::string parent = rfs->getDirID(tinfo->safeTitle, rfsRootID);
+        std::vector<std::string> tmpZips;
+        rfs::transferMngr transfers(rfs, cfg::remoteMaxTransfers, (uint64_t)cfg::remoteMaxKBps * 1024);
+        skipped += remoteQueueUploads(transfers, titlePath, parent, tmpZips, t);
+
+        if(transfers.getCount() > 0)
+        {
+            fs::copyArgs *cpyArgs = fs::copyArgsCreate("", "", "", NULL, NULL, false, false, 0);
+            t->argPtr = cpyArgs;
+            t->drawFunc = fs::fileDrawFunc;
+            transfers.setStatusHeader(tinfo->title);
+            transfers.run(t);
+            t->drawFunc = NULL;
+            t->argPtr = NULL;
+            fs::copyArgsDestroy(cpyArgs);
+        }
+
+        for(const std::string& z : tmpZips)
+            fs::delfile(z);
+
+        sent += transfers.getCount();
+        failed += transfers.getFailedCount();
+    }
+
+    if(cfg::config["ovrClk"])
+        util::sysNormal();
+
+    if(failed > 0)
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteTransfersFailed", 0), failed, sent);
+    else
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteSyncDone", 0), sent, skipped);
+
+    t->finished = true;
+}
@@ -0,0 +1,358 @@
+#include <switch.h>
+#include <stdio.h>
+#include <string>
+#include <deque>
+#include <atomic>
+
+#include "fs.h"
+#include "cfg.h"
+#include "data.h"
+#include "util.h"
+#include "ui.h"
+
+#define QUEUE_PATH "sdmc:/config/JKSV/uploadQueue.txt"
+//Wait after a failed upload before trying again. Multiplied by how many times it failed, up to the max
+#define QUEUE_RETRY_WAIT 30
+#define QUEUE_RETRY_WAIT_MAX 600
+
+typedef struct
+{
+    uint64_t tid;
+    unsigned attempts;
+    std::string path;
+    //Taken when queued so the worker never has to look at data::titles while the user could be changing it
+    std::string safeTitle;
+} queueEntry;
+
+static std::deque<queueEntry> uploadQueue;
+static Mutex queueLock = 0;
+static bool queueRunning = false;
+//Read by the worker and its curl requests without queueLock. queueItemCancel is also set when queueStop is.
+static std::atomic<bool> queueStop(false), queueItemCancel(false);
+static rfs::transferMngr *queueTransfers = NULL;
+//Backup the worker is on. Foreground tasks that change it have the worker let go of it first
+static std::string queueActivePath;
+
+//Has to be called with queueLock held
+static void queueSave()
+{
+    FILE *queueOut = fopen(QUEUE_PATH, "w");
+    if(!queueOut)
+        return;
+
+    for(const queueEntry& e : uploadQueue)
+        fprintf(queueOut, "0x%016lX\t%u\t%s\n", e.tid, e.attempts, e.path.c_str());
+
+    fclose(queueOut);
+}
+
+static void queueLoad()
+{
+    FILE *queueIn = fopen(QUEUE_PATH, "r");
+    if(!queueIn)
+        return;
+
+    char line[0x400], path[0x300];
+    while(fgets(line, 0x400, queueIn))
+    {
+        queueEntry e;
+        //Titles that were uninstalled or blacklisted since have no folder to go in, so they're dropped
+        if(sscanf(line, "0x%016lX\t%u\t%767[^\n]", &e.tid, &e.attempts, path) == 3 && data::getTitleInfoByTID(e.tid) && !cfg::isBlacklisted(e.tid))
+        {
+            e.path = path;
+            e.safeTitle = data::getTitleSafeNameByTID(e.tid);
+            uploadQueue.push_back(e);
+        }
+    }
+    fclose(queueIn);
+}
+
+//Sleeps in short steps so exiting doesn't have to wait out the whole thing
+static void queueWait(unsigned _seconds)
+{
+    for(unsigned i = 0; i < _seconds * 4 && !queueStop; i++)
+        svcSleepThread(250000000);
+}
+
+//Has to be called with queueLock held. _path can be a backup or a folder of them.
+static bool queueActiveIn(const std::string& _path)
+{
+    if(queueActivePath.empty())
+        return false;
+
+    return queueActivePath == _path || queueActivePath.compare(0, _path.length() + 1, _path + "/") == 0;
+}
+
+//Waits until the worker isn't on _path anymore
+static void queueWaitForPath(const std::string& _path)
+{
+    while(true)
+    {
+        mutexLock(&queueLock);
+        bool active = queueActiveIn(_path);
+        mutexUnlock(&queueLock);
+        if(!active)
+            break;
+
+        svcSleepThread(10000000);
+    }
+}
+
+//Has to be called with queueLock held
+static void queueCancelActive()
+{
+    queueItemCancel = true;
+    if(queueTransfers)
+        queueTransfers->cancel();
+}
+
+static bool queueUpload(const queueEntry& _e, threadInfo *t)
+{
+    if(!fs::rfs->dirExists(_e.safeTitle, fs::rfsRootID))
+        fs::rfs->createDir(_e.safeTitle, fs::rfsRootID);
+
+    std::string parent = fs::rfs->getDirID(_e.safeTitle, fs::rfsRootID);
+    std::string filename = util::getFilenameFromPath(_e.path), path = _e.path, tmpZip;
+    if(fs::isDir(_e.path))
+    {
+        t->status->setStatus(ui::getUICString("threadStatusCompressingSaveForUpload", 0), filename.c_str());
+        filename += ".zip";
+        path = tmpZip = fs::remoteTmpPath(".zip");
+
+        int zipTrim = util::getTotalPlacesInPath(fs::getWorkDir()) + 2;
+        zipFile tmp = zipOpen64(tmpZip.c_str(), 0);
+        fs::copyDirToZip(_e.path + "/", tmp, true, zipTrim, NULL);
+        zipClose(tmp, NULL);
+    }
+
+    bool ok = true;
+    if(cfg::config["remoteChunks"])
+        ok = fs::chunkUpload(path, filename, parent, t) && !queueItemCancel;
+    else
+    {
+        std::string sendPath = fs::remoteCompressUpload(path, filename, t);
+        std::string fileID = fs::rfs->fileExists(filename, parent) ? fs::rfs->getFileID(filename, parent) : "";
+        if(!fs::rfs->remoteMatches(sendPath, fileID))
+        {
+            rfs::transferMngr transfers(fs::rfs, 1, (uint64_t)cfg::remoteMaxKBps * 1024);
+            transfers.addUpload(sendPath, filename, parent, fileID);
+
+            char header[128];
+            snprintf(header, 128, ui::getUICString("threadStatusUploadQueue", 0), fs::remoteQueueCount());
+            transfers.setStatusHeader(header);
+
+            mutexLock(&queueLock);
+            queueTransfers = queueItemCancel ? NULL : &transfers;
+            mutexUnlock(&queueLock);
+
+            if(queueTransfers)
+                transfers.run(t);
+
+            mutexLock(&queueLock);
+            queueTransfers = NULL;
+            mutexUnlock(&queueLock);
+
+            ok = !queueItemCancel && transfers.getFailedCount() == 0;
+        }
+
+        if(sendPath != path)
+            fs::delfile(sendPath);
+    }
+
+    if(!tmpZip.empty())
+        fs::delfile(tmpZip);
+
+    return ok;
+}
+
+static void remoteQueue_t(void *a)
+{
+    threadInfo *t = (threadInfo *)a;
+    //Chunked uploads run their own transfers, so requests are aborted through curl instead of queueTransfers
+    curlFuncs::setThreadCancelFlag(&queueItemCancel);
+    while(!queueStop)
+    {
+        //Claimed before checking for foreground tasks. Anything that starts after has to go through remoteQueueRelease and sees it.
+        mutexLock(&queueLock);
+        bool empty = uploadQueue.empty();
+        queueEntry e = empty ? queueEntry() : uploadQueue.front();
+        if(!empty)
+        {
+            queueActivePath = e.path;
+            queueItemCancel = queueStop.load();
+        }
+        mutexUnlock(&queueLock);
+        if(empty)
+            break;
+
+        //Nothing to send to. Entries stay on SD for when there is
+        //Stay out of the way of anything the user started
+        bool idle = fs::rfs && ui::foregroundIdle();
+        if(!idle)
+        {
+            mutexLock(&queueLock);
+            queueActivePath.clear();
+            mutexUnlock(&queueLock);
+            if(!fs::rfs)
+                break;
+
+            t->status->setStatus(ui::getUICString("threadStatusUploadQueueWaiting", 0), fs::remoteQueueCount());
+            queueWait(1);
+            continue;
+        }
+
+        //Deleted or renamed since it was queued
+        bool exists = fs::isDir(e.path) || fs::fileExists(e.path);
+        bool ok = !exists || queueUpload(e, t);
+
+        mutexLock(&queueLock);
+        queueActivePath.clear();
+        //Let go of for a foreground task or removed. It stays where it is, or is already gone.
+        bool released = queueItemCancel;
+        mutexUnlock(&queueLock);
+        if(queueStop)
+            break;
+        else if(released)
+        {
+            //Gives whatever asked for it time to start before the foreground is checked again
+            queueWait(1);
+            continue;
+        }
+
+        mutexLock(&queueLock);
+        if(!uploadQueue.empty() && uploadQueue.front().path == e.path)
+            uploadQueue.pop_front();
+
+        unsigned wait = 0;
+        if(!ok)
+        {
+            //Goes to the back so one bad backup doesn't hold up the rest
+            fs::logWrite("remoteQueue: Upload of %s failed. Retrying later.\n", e.path.c_str());
+            e.attempts++;
+            uploadQueue.push_back(e);
+            wait = e.attempts * QUEUE_RETRY_WAIT < QUEUE_RETRY_WAIT_MAX ? e.attempts * QUEUE_RETRY_WAIT : QUEUE_RETRY_WAIT_MAX;
+        }
+        queueSave();
+        mutexUnlock(&queueLock);
+
+        if(wait > 0)
+        {
+            t->status->setStatus(ui::getUICString("threadStatusUploadQueueRetry", 0), wait);
+            queueWait(wait);
+        }
+    }
+
+    curlFuncs::setThreadCancelFlag(NULL);
+    mutexLock(&queueLock);
+    queueRunning = false;
+    mutexUnlock(&queueLock);
+    t->finished = true;
+}
+
+//Has to be called with queueLock held
+static void queueStart()
+{
+    if(queueRunning || queueStop || uploadQueue.empty())
+        return;
+
+    queueRunning = ui::newBackgroundThread(remoteQueue_t, NULL) != NULL;
+}
+
+void fs::remoteQueueInit()
+{
+    mutexLock(&queueLock);
+    queueLoad();
+    queueStart();
+    mutexUnlock(&queueLock);
+}
+
+void fs::remoteQueueExit()
+{
+    mutexLock(&queueLock);
+    queueStop = true;
+    queueCancelActive();
+    mutexUnlock(&queueLock);
+
+    //Worker uses fs::rfs, so it has to be done before the remote is freed
+    while(true)
+    {
+        mutexLock(&queueLock);
+        bool running = queueRunning;
+        mutexUnlock(&queueLock);
+        if(!running)
+            break;
+
+        svcSleepThread(10000000);
+    }
+}
+
+void fs::remoteQueueAdd(uint64_t _tid, const std::string& _path)
+{
+    //Called from foreground tasks, so titles and the blacklist can't change under this
+    if(!cfg::config["autoUpload"] || !data::getTitleInfoByTID(_tid) || cfg::isBlacklisted(_tid))
+        return;
+
+    std::string safeTitle = data::getTitleSafeNameByTID(_tid);
+    mutexLock(&queueLock);
+    bool queued = false;
+    for(const queueEntry& e : uploadQueue)
+    {
+        if(e.path == _path)
+        {
+            queued = true;
+            break;
+        }
+    }
+
+    if(!queued)
+    {
+        uploadQueue.push_back({ _tid, 0, _path, safeTitle });
+        queueSave();
+    }
+    queueStart();
+    mutexUnlock(&queueLock);
+}
+
+unsigned fs::remoteQueueCount()
+{
+    mutexLock(&queueLock);
+    unsigned ret = uploadQueue.size();
+    mutexUnlock(&queueLock);
+    return ret;
+}
+
+void fs::remoteQueueRelease(const std::string& _path)
+{
+    mutexLock(&queueLock);
+    if(queueActiveIn(_path))
+        queueCancelActive();
+    mutexUnlock(&queueLock);
+
+    queueWaitForPath(_path);
+}
+
+void fs::remoteQueueRemoveTitle(uint64_t _tid)
+{
+    std::string activePath;
+    mutexLock(&queueLock);
+    for(auto e = uploadQueue.begin(); e != uploadQueue.end(); )
+    {
+        if(e->tid != _tid)
+        {
+            ++e;
+            continue;
+        }
+
+        if(e->path == queueActivePath)
+        {
+            activePath = queueActivePath;
+            queueCancelActive();
+        }
+        e = uploadQueue.erase(e);
+    }
+    queueSave();
+    mutexUnlock(&queueLock);
+
+    if(!activePath.empty())
+        queueWaitForPath(activePath);
+}
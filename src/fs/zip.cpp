@@ -1,44 +1,55 @@
 #include <switch.h>
 #include <time.h>
+#include <sys/stat.h>
 #include <mutex>
 #include <vector>
+#include <set>
+#include <unordered_set>
 #include <condition_variable>
 
 #include "fs.h"
 #include "util.h"
 #include "cfg.h"
 
+//Files this big or bigger get zip64 headers. Left under 4GB because deflate can come out a little bigger than what went in.
+#define ZIP64_FILE_MIN 0xF0000000
+
 typedef struct
 {
     std::mutex buffLock;
     std::condition_variable cond;
     std::vector<uint8_t> sharedBuffer;
     std::string dst, dev;
-    bool bufferIsFull = false;
+    //Writer runs until readDone. Sizes in the zip can't be trusted to end it.
+    bool bufferIsFull = false, readDone = false;
     unzFile unz;
-    unsigned int fileSize, writeLimit = 0;
+    uint64_t writeLimit = 0;
 } unzThrdArgs;
 
 static void writeFileFromZip_t(void *a)
 {
     unzThrdArgs *in = (unzThrdArgs *)a;
     std::vector<uint8_t> localBuffer;
-    unsigned int written = 0, journalCount = 0;
+    uint64_t journalCount = 0;
 
     FILE *out = fopen(in->dst.c_str(), "wb");
-    while(written < in->fileSize)
+    while(true)
     {
         std::unique_lock<std::mutex> buffLock(in->buffLock);
-        in->cond.wait(buffLock, [in]{ return in->bufferIsFull; });
-        localBuffer.clear();
-        localBuffer.assign(in->sharedBuffer.begin(), in->sharedBuffer.end());
+        in->cond.wait(buffLock, [in]{ return in->bufferIsFull || in->readDone; });
+        if(!in->bufferIsFull)
+            break;
+
+        localBuffer.swap(in->sharedBuffer);
         in->sharedBuffer.clear();
         in->bufferIsFull = false;
         buffLock.unlock();
         in->cond.notify_one();
 
-        written += fwrite(localBuffer.data(), 1, localBuffer.size(), out);
-        journalCount += written;
+        if(!out)
+            continue;
+
+        journalCount += fwrite(localBuffer.data(), 1, localBuffer.size(), out);
         if(journalCount >= in->writeLimit)
         {
             journalCount = 0;
@@ -47,7 +58,24 @@ static void writeFileFromZip_t(void *a)
             out = fopen(in->dst.c_str(), "ab");
         }
     }
-    fclose(out);
+
+    if(out)
+        fclose(out);
+}
+
+static void unzHandOff(unzThrdArgs *in, std::vector<uint8_t>& _buffer, bool _last)
+{
+    std::unique_lock<std::mutex> buffLock(in->buffLock);
+    in->cond.wait(buffLock, [in]{ return in->bufferIsFull == false; });
+    if(!_buffer.empty())
+    {
+        in->sharedBuffer.swap(_buffer);
+        _buffer.clear();
+        in->bufferIsFull = true;
+    }
+    in->readDone = _last;
+    buffLock.unlock();
+    in->cond.notify_one();
 }
 
 void fs::copyDirToZip(const std::string& src, zipFile dst, bool trimPath, int trimPlaces, threadInfo *t)
@@ -73,8 +101,14 @@ void fs::copyDirToZip(const std::string& src, zipFile dst, bool trimPath, int tr
         }
         else
         {
-            time_t raw;
-            time(&raw);
+            //Use the file's own time when there is one so zipping the same files twice gives the same zip.
+            //Remote uploads rely on this to tell whether a folder backup changed.
+            time_t raw = 0;
+            struct stat fileStat;
+            if(stat((src + itm).c_str(), &fileStat) == 0)
+                raw = fileStat.st_mtime;
+            if(raw == 0)
+                time(&raw);
             tm *locTime = localtime(&raw);
             zip_fileinfo inf = { locTime->tm_sec, locTime->tm_min, locTime->tm_hour,
                                  locTime->tm_mday, locTime->tm_mon, (1900 + locTime->tm_year), 0, 0, 0 };
@@ -89,14 +123,17 @@ void fs::copyDirToZip(const std::string& src, zipFile dst, bool trimPath, int tr
             if(t)
                 t->status->setStatus(ui::getUICString("threadStatusAddingFileToZip", 0), itm.c_str());
 
-            int zipOpenFile = zipOpenNewFileInZip64(dst, filename.substr(zipNameStart, filename.npos).c_str(), &inf, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION, 0);
+            //Zip64 headers are only needed near 4GB and up. Smaller files keep plain ones so older unzippers still work.
+            //Offsets past 4GB and more than 0xFFFF entries are handled by minizip in the central directory and zipClose, as long as the zip was opened with zipOpen64.
+            std::string fullSrc = src + itm;
+            uint64_t fileSize = fs::fsize(fullSrc);
+            int zipOpenFile = zipOpenNewFileInZip64(dst, filename.substr(zipNameStart, filename.npos).c_str(), &inf, NULL, 0, NULL, 0, NULL, Z_DEFLATED, Z_DEFAULT_COMPRESSION, fileSize >= ZIP64_FILE_MIN ? 1 : 0);
             if(zipOpenFile == ZIP_OK)
             {
-                std::string fullSrc = src + itm;
                 if(c)
                 {
                     c->offset = 0;
-                    c->prog->setMax(fs::fsize(fullSrc));
+                    c->prog->setMax(fileSize);
                     c->prog->update(0);
                 }
 
@@ -111,6 +148,11 @@ void fs::copyDirToZip(const std::string& src, zipFile dst, bool trimPath, int tr
                 }
                 delete[] buff;
                 fclose(fsrc);
+
+                //Sizes are written here. This is where a file that needed zip64 and didn't get it fails.
+                int zipClosed = zipCloseFileInZip(dst);
+                if(zipClosed != ZIP_OK)
+                    fs::logWrite("copyDirToZip: Failed to finish %s in zip: %i.\n", fullSrc.c_str(), zipClosed);
             }
         }
     }
@@ -134,14 +176,18 @@ void copyDirToZip_t(void *a)
     if(c->cleanup)
     {
         zipClose(c->z, NULL);
+        if(!c->uploadPath.empty())
+            fs::remoteQueueAdd(c->uploadTID, c->uploadPath);
         delete c;
     }
     t->finished = true;
 }
 
-void fs::copyDirToZipThreaded(const std::string& src, zipFile dst, bool trimPath, int trimPlaces)
+void fs::copyDirToZipThreaded(const std::string& src, zipFile dst, bool trimPath, int trimPlaces, uint64_t _uploadTID, const std::string& _uploadPath)
 {
     fs::copyArgs *send = fs::copyArgsCreate(src, "", "", dst, NULL, true, false, 0);
+    send->uploadTID = _uploadTID;
+    send->uploadPath = _uploadPath;
     ui::newThread(copyDirToZip_t, send, fs::fileDrawFunc);
 }
 
@@ -157,9 +203,25 @@ void fs::copyZipToDir(unzFile src, const std::string& dst, const std::string& de
     uint8_t *buff = new uint8_t[BUFF_SIZE];
     int readIn = 0;
     unz_file_info64 info;
+
+    //Create every folder the archive needs up front from the central directory so extraction doesn't have to check each time
+    std::unordered_set<std::string> madeDirs;
+    std::set<std::string> zipDirs;
+    do
+    {
+        unzGetCurrentFileInfo64(src, &info, filename, FS_MAX_PATH, NULL, 0, NULL, 0);
+        std::string fullDst = dst + filename;
+        zipDirs.insert(fullDst.substr(0, fullDst.find_last_of('/') + 1));
+    } while(unzGoToNextFile(src) == UNZ_OK);
+
+    for(const std::string& d : zipDirs)
+        fs::mkDirRec(d, madeDirs);
+
+    unzGoToFirstFile(src);
     do
     {
         unzGetCurrentFileInfo64(src, &info, filename, FS_MAX_PATH, NULL, 0, NULL, 0);
+        std::string fullDst = dst + filename;
         if(unzOpenCurrentFile(src) == UNZ_OK)
         {
             if(t)
@@ -172,12 +234,8 @@ void fs::copyZipToDir(unzFile src, const std::string& dst, const std::string& de
                 c->offset = 0;
             }
 
-            std::string fullDst = dst + filename;
-            fs::mkDirRec(fullDst.substr(0, fullDst.find_last_of('/') + 1));
-
             unzThrdArgs unzThrd;
             unzThrd.dst = fullDst;
-            unzThrd.fileSize = info.uncompressed_size;
             unzThrd.dev = dev;
             unzThrd.writeLimit = (journalSize - 0x100000) < TRANSFER_BUFFER_LIMIT ? (journalSize - 0x100000) : TRANSFER_BUFFER_LIMIT;
 
@@ -186,31 +244,30 @@ void fs::copyZipToDir(unzFile src, const std::string& dst, const std::string& de
             threadStart(&writeThread);
 
             std::vector<uint8_t> transferBuffer;
-            uint64_t readCount = 0;
+            uint64_t readTotal = 0;
             while((readIn = unzReadCurrentFile(src, buff, BUFF_SIZE)) > 0)
             {
                 transferBuffer.insert(transferBuffer.end(), buff, buff + readIn);
-                readCount += readIn;
+                readTotal += readIn;
 
                 if(c)
                     c->offset += readIn;
 
-                if(transferBuffer.size() >= unzThrd.writeLimit || readCount == info.uncompressed_size)
-                {
-                    std::unique_lock<std::mutex> buffLock(unzThrd.buffLock);
-                    unzThrd.cond.wait(buffLock, [&unzThrd]{ return unzThrd.bufferIsFull == false; });
-                    unzThrd.sharedBuffer.assign(transferBuffer.begin(), transferBuffer.end());
-                    transferBuffer.clear();
-                    unzThrd.bufferIsFull = true;
-                    unzThrd.cond.notify_one();
-                }
+                if(transferBuffer.size() >= unzThrd.writeLimit)
+                    unzHandOff(&unzThrd, transferBuffer, false);
             }
+            unzHandOff(&unzThrd, transferBuffer, true);
             threadWaitForExit(&writeThread);
             threadClose(&writeThread);
             fs::commitToDevice(dev);
+
+            //Round trip check. CRC is only compared once the whole file was read, and the size catches anything cut off at 4GB.
+            int unzClosed = unzCloseCurrentFile(src);
+            if(readIn < 0 || unzClosed != UNZ_OK || readTotal != info.uncompressed_size)
+                fs::logWrite("copyZipToDir: %s didn't extract cleanly. Read %llu of %llu bytes, error %i.\n", filename, (unsigned long long)readTotal, (unsigned long long)info.uncompressed_size, readIn < 0 ? readIn : unzClosed);
         }
     }
-    while(unzGoToNextFile(src) != UNZ_END_OF_LIST_OF_FILE);
+    while(unzGoToNextFile(src) == UNZ_OK);
     delete[] buff;
 }
 
@@ -244,7 +301,7 @@ uint64_t fs::getZipTotalSize(unzFile unz)
         {
             unzGetCurrentFileInfo64(unz, &finfo, filename, FS_MAX_PATH, NULL, 0, NULL, 0);
             ret += finfo.uncompressed_size;
-        } while(unzGoToNextFile(unz) != UNZ_END_OF_LIST_OF_FILE);
+        } while(unzGoToNextFile(unz) == UNZ_OK);
         unzGoToFirstFile(unz);
     }
     return ret;
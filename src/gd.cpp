@@ -5,6 +5,7 @@
 #include <vector>
 #include <mutex>
 #include <condition_variable>
+#include <time.h>
 
 #include "gd.h"
 #include "fs.h"
@@ -16,12 +17,28 @@ Google Drive code for JKSV.
 Still major WIP
 */
 
-#define DRIVE_DEFAULT_PARAMS_AND_QUERY "?fields=files(name,id,mimeType,size,parents)&pageSize=1000&q=trashed=false\%20and\%20\%27me\%27\%20in\%20owners"
+#define DRIVE_DEFAULT_PARAMS_AND_QUERY "?fields=nextPageToken,files(name,id,mimeType,size,parents,sha256Checksum)&pageSize=1000&q=trashed=false\%20and\%20\%27me\%27\%20in\%20owners"
+#define DRIVE_CHANGES_PARAMS "&fields=nextPageToken,newStartPageToken,changes(fileId,removed,file(name,id,mimeType,size,parents,sha256Checksum,trashed,ownedByMe))&pageSize=1000&spaces=drive"
 
 #define tokenURL "https://oauth2.googleapis.com/token"
-#define tokenCheckURL "https://oauth2.googleapis.com/tokeninfo"
 #define driveURL "https://www.googleapis.com/drive/v3/files"
 #define driveUploadURL "https://www.googleapis.com/upload/drive/v3/files"
+#define driveChangesURL "https://www.googleapis.com/drive/v3/changes"
+
+//Minimum seconds between checking the changes feed when the folder list is requested
+#define DRIVE_SYNC_INTERVAL 10
+
+//How long before the token expires it gets refreshed in the background
+#define TOKEN_REFRESH_AHEAD 300
+//Foreground requests refresh on their own if it's closer than this
+#define TOKEN_EXPIRE_MARGIN 30
+//Wait before trying again if a background refresh fails
+#define TOKEN_RETRY_WAIT 30
+
+//Uploads are sent in pieces this size. Drive requires a multiple of 256KB
+#define UPLOAD_CHUNK_SIZE 0x800000
+//How many times a chunk is retried before giving up. Wait doubles each time starting at one second
+#define UPLOAD_MAX_RETRIES 5
 
 static inline void writeDriveError(const std::string& _function, const std::string& _message)
 {
@@ -35,6 +52,8 @@ static inline void writeCurlError(const std::string& _function, int _cerror)
 
 bool drive::gd::exhangeAuthCode(const std::string& _authCode)
 {
+    bool ret = false;
+
     // Header
     curl_slist *postHeader = NULL;
     postHeader = curl_slist_append(postHeader, HEADER_CONTENT_TYPE_APP_JSON);
@@ -54,7 +73,7 @@ bool drive::gd::exhangeAuthCode(const std::string& _authCode)
 
     // Curl Request
     std::string *jsonResp = new std::string;
-    CURL *curl = curl_easy_init();
+    CURL *curl = curlFuncs::borrowHandle();
     curl_easy_setopt(curl, CURLOPT_HTTPPOST, 1);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, postHeader);
@@ -70,11 +89,13 @@ bool drive::gd::exhangeAuthCode(const std::string& _authCode)
     {
         json_object *accessToken = json_object_object_get(respParse, "access_token");
         json_object *refreshToken = json_object_object_get(respParse, "refresh_token");
+        json_object *expiresIn = json_object_object_get(respParse, "expires_in");
 
         if(accessToken && refreshToken)
         {
-            token = json_object_get_string(accessToken);
+            setToken(json_object_get_string(accessToken), expiresIn ? json_object_get_int(expiresIn) : 0);
             rToken = json_object_get_string(refreshToken);
+            ret = true;
         }
         else
             writeDriveError("exchangeAuthCode", jsonResp->c_str());
@@ -86,15 +107,29 @@ bool drive::gd::exhangeAuthCode(const std::string& _authCode)
     json_object_put(post);
     json_object_put(respParse);
     curl_slist_free_all(postHeader);
-    curl_easy_cleanup(curl);
+    curlFuncs::returnHandle(curl);
 
-    return true;
+    return ret;
 }
 
 bool drive::gd::refreshToken()
 {
     bool ret = false;
 
+    //Only one refresh goes out at a time. Anyone else asking while it runs gets its result
+    mutexLock(&tokenLock);
+    if(tokenRefreshing)
+    {
+        while(tokenRefreshing)
+            condvarWait(&tokenCond, &tokenLock);
+
+        ret = tokenRefreshed;
+        mutexUnlock(&tokenLock);
+        return ret;
+    }
+    tokenRefreshing = true;
+    mutexUnlock(&tokenLock);
+
     // Header
     curl_slist *header = NULL;
     header = curl_slist_append(header, HEADER_CONTENT_TYPE_APP_JSON);
@@ -112,7 +147,7 @@ bool drive::gd::refreshToken()
 
     // Curl
     std::string *jsonResp = new std::string;
-    CURL *curl = curl_easy_init();
+    CURL *curl = curlFuncs::borrowHandle();
     curl_easy_setopt(curl, CURLOPT_HTTPPOST, 1);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
     curl_easy_setopt(curl, CURLOPT_HTTPHEADER, header);
@@ -125,133 +160,284 @@ bool drive::gd::refreshToken()
     json_object *parse = json_tokener_parse(jsonResp->c_str());
     if (error == CURLE_OK)
     {
-        json_object *accessToken, *error;
+        json_object *accessToken = NULL, *expiresIn = NULL, *error = NULL;
         json_object_object_get_ex(parse, "access_token", &accessToken);
+        json_object_object_get_ex(parse, "expires_in", &expiresIn);
         json_object_object_get_ex(parse, "error", &error);
 
         if(accessToken)
         {
-            token = json_object_get_string(accessToken);
+            setToken(json_object_get_string(accessToken), expiresIn ? json_object_get_int(expiresIn) : 0);
             ret = true;
         }
         else if(error)
             writeDriveError("refreshToken", jsonResp->c_str());
     }
+    else
+        writeCurlError("refreshToken", error);
 
     delete jsonResp;
     json_object_put(post);
     json_object_put(parse);
     curl_slist_free_all(header);
-    curl_easy_cleanup(curl);
+    curlFuncs::returnHandle(curl);
+
+    mutexLock(&tokenLock);
+    tokenRefreshing = false;
+    tokenRefreshed = ret;
+    condvarWakeAll(&tokenCond);
+    mutexUnlock(&tokenLock);
 
     return ret;
 }
 
-bool drive::gd::tokenIsValid()
+drive::gd::~gd()
 {
-    bool ret = false;
+    stopTokenRefresh();
+}
+
+void drive::gd::setToken(const std::string& _token, int _expiresIn)
+{
+    mutexLock(&tokenLock);
+    token = _token;
+    //No expires_in means we don't know. Assume the usual hour
+    tokenExpire = time(NULL) + (_expiresIn > 0 ? _expiresIn : 3600);
+    mutexUnlock(&tokenLock);
+}
 
-    std::string url = tokenCheckURL;
-    url.append("?access_token=" + token);
+std::string drive::gd::getToken()
+{
+    mutexLock(&tokenLock);
+    bool expired = time(NULL) + TOKEN_EXPIRE_MARGIN >= tokenExpire;
+    mutexUnlock(&tokenLock);
 
-    CURL *curl = curl_easy_init();
-    std::string *jsonResp = new std::string;
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, jsonResp);
+    //Background refresh should normally beat this
+    if(expired)
+        refreshToken();
 
-    int error = curl_easy_perform(curl);
-    json_object *parse = json_tokener_parse(jsonResp->c_str());
-    if (error == CURLE_OK)
+    mutexLock(&tokenLock);
+    std::string ret = token;
+    mutexUnlock(&tokenLock);
+    return ret;
+}
+
+static void tokenRefresh_t(void *a)
+{
+    drive::gd *g = (drive::gd *)a;
+    g->tokenRefreshLoop();
+}
+
+void drive::gd::tokenRefreshLoop()
+{
+    mutexLock(&refreshLock);
+    while(refreshRunning)
     {
-        json_object *checkError;
-        json_object_object_get_ex(parse, "error", &checkError);
-        if(!checkError)
-            ret = true;
+        mutexLock(&tokenLock);
+        time_t wait = tokenExpire - TOKEN_REFRESH_AHEAD - time(NULL);
+        mutexUnlock(&tokenLock);
+
+        if(wait <= 0)
+        {
+            mutexUnlock(&refreshLock);
+            bool refreshed = refreshToken();
+            mutexLock(&refreshLock);
+            if(refreshed || !refreshRunning)
+                continue;
+
+            wait = TOKEN_RETRY_WAIT;
+        }
+        condvarWaitTimeout(&refreshCond, &refreshLock, (uint64_t)wait * 1000000000);
     }
+    mutexUnlock(&refreshLock);
+}
 
-    delete jsonResp;
-    json_object_put(parse);
-    curl_easy_cleanup(curl);
-    return ret;
+void drive::gd::startTokenRefresh()
+{
+    if(refreshRunning)
+        return;
+
+    refreshRunning = true;
+    if(R_SUCCEEDED(threadCreate(&refreshThread, tokenRefresh_t, this, NULL, 0x8000, 0x3B, -2)))
+        threadStart(&refreshThread);
+    else
+        refreshRunning = false;
 }
 
-static int requestList(const std::string& _url, const std::string& _token, std::string *_respOut)
+void drive::gd::stopTokenRefresh()
 {
-    int ret = 0;
+    if(!refreshRunning)
+        return;
+
+    mutexLock(&refreshLock);
+    refreshRunning = false;
+    condvarWakeAll(&refreshCond);
+    mutexUnlock(&refreshLock);
+
+    threadWaitForExit(&refreshThread);
+    threadClose(&refreshThread);
+}
+
+int drive::gd::performWithAuth(CURL *_curl, const std::vector<std::string>& _headers, std::string *_respOut, std::vector<std::string> *_headersOut)
+{
+    int error = CURLE_OK;
+    for(int i = 0; i < 2; i++)
+    {
+        curl_slist *reqHeaders = NULL;
+        reqHeaders = curl_slist_append(reqHeaders, std::string(HEADER_AUTHORIZATION + getToken()).c_str());
+        for(const std::string& h : _headers)
+            reqHeaders = curl_slist_append(reqHeaders, h.c_str());
+
+        curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, reqHeaders);
+        error = curl_easy_perform(_curl);
+        curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, NULL);
+        curl_slist_free_all(reqHeaders);
+
+        long respCode = 0;
+        curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &respCode);
+        if(i > 0 || respCode != 401)
+            break;
+
+        //Token was revoked or expired early. Get a new one and try once more.
+        writeDriveError("performWithAuth", "401 returned. Refreshing token and retrying.");
+        if(!refreshToken())
+            break;
 
-    // Headers needed
-    curl_slist *postHeaders = NULL;
-    postHeaders = curl_slist_append(postHeaders, std::string(HEADER_AUTHORIZATION + _token).c_str());
+        if(_respOut)
+            _respOut->clear();
+        if(_headersOut)
+            _headersOut->clear();
+    }
+    return error;
+}
+
+int drive::gd::requestList(const std::string& _url, std::string *_respOut)
+{
+    int ret = 0;
 
-    CURL *curl = curl_easy_init();
+    CURL *curl = curlFuncs::borrowHandle();
     curl_easy_setopt(curl, CURLOPT_HTTPGET, 1);
     curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
     curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, postHeaders);
     curl_easy_setopt(curl, CURLOPT_URL, _url.c_str());
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, _respOut);
-    ret = curl_easy_perform(curl);
-
+    ret = performWithAuth(curl, {}, _respOut, NULL);
 
-    curl_slist_free_all(postHeaders);
-    curl_easy_cleanup(curl);
+    curlFuncs::returnHandle(curl);
 
     return ret;
 }
 
-static void processList(const std::string& _json, std::vector<rfs::RfsItem>& _drvl, bool _clear)
+static rfs::RfsItem parseFileItem(json_object *_file)
 {
-    if(_clear)
-        _drvl.clear();
+    json_object *idString = NULL, *nameString = NULL, *mimeTypeString = NULL, *size = NULL, *parentArray = NULL, *checksum = NULL;
+    json_object_object_get_ex(_file, "id", &idString);
+    json_object_object_get_ex(_file, "name", &nameString);
+    json_object_object_get_ex(_file, "mimeType", &mimeTypeString);
+    json_object_object_get_ex(_file, "size", &size);
+    json_object_object_get_ex(_file, "parents", &parentArray);
+    json_object_object_get_ex(_file, "sha256Checksum", &checksum);
+
+    rfs::RfsItem newItem;
+    newItem.name = json_object_get_string(nameString);
+    newItem.id = json_object_get_string(idString);
+    newItem.size = json_object_get_int64(size);
+    if(checksum)
+        newItem.checksum = json_object_get_string(checksum);
+    if(mimeTypeString && strcmp(json_object_get_string(mimeTypeString), MIMETYPE_FOLDER) == 0)
+        newItem.isDir = true;
+
+    if (parentArray)
+    {
+        size_t parentCount = json_object_array_length(parentArray);
+        //There can only be 1 parent, but it's held in an array...
+        for (unsigned j = 0; j < parentCount; j++)
+        {
+            json_object *parent = json_object_array_get_idx(parentArray, j);
+            newItem.parent = json_object_get_string(parent);
+        }
+    }
+    return newItem;
+}
 
-    json_object *parse = json_tokener_parse(_json.c_str()), *fileArray;
+//Parent IDs never contain '/', so this can't collide
+static inline std::string indexKey(const std::string& _parent, const std::string& _name)
+{
+    return _parent + "/" + _name;
+}
+
+void drive::gd::listItemAdd(const rfs::RfsItem& _item)
+{
+    rmutexLock(&listLock);
+    //Could be a rename or move from the changes feed
+    if(driveItems.find(_item.id) != driveItems.end())
+        listItemRemove(_item.id);
+
+    driveItems[_item.id] = _item;
+    driveChildren[_item.parent].insert(_item.id);
+    if(_item.isDir)
+        dirIndex[indexKey(_item.parent, _item.name)] = _item.id;
+    else
+        fileIndex[indexKey(_item.parent, _item.name)] = _item.id;
+    rmutexUnlock(&listLock);
+}
+
+void drive::gd::listItemRemove(const std::string& _id)
+{
+    rmutexLock(&listLock);
+    auto findItem = driveItems.find(_id);
+    if(findItem != driveItems.end())
+    {
+        rfs::RfsItem& item = findItem->second;
+        std::unordered_map<std::string, std::string>& index = item.isDir ? dirIndex : fileIndex;
+        auto findIndex = index.find(indexKey(item.parent, item.name));
+        if(findIndex != index.end() && findIndex->second == _id)
+            index.erase(findIndex);
+
+        auto findParent = driveChildren.find(item.parent);
+        if(findParent != driveChildren.end())
+        {
+            findParent->second.erase(_id);
+            if(findParent->second.empty())
+                driveChildren.erase(findParent);
+        }
+        driveItems.erase(findItem);
+    }
+    rmutexUnlock(&listLock);
+}
+
+void drive::gd::clearDriveList()
+{
+    rmutexLock(&listLock);
+    driveItems.clear();
+    driveChildren.clear();
+    dirIndex.clear();
+    fileIndex.clear();
+    rmutexUnlock(&listLock);
+}
+
+std::string drive::gd::processList(const std::string& _json)
+{
+    std::string nextPage;
+    json_object *parse = json_tokener_parse(_json.c_str()), *fileArray = NULL, *nextPageToken = NULL;
     json_object_object_get_ex(parse, "files", &fileArray);
+    json_object_object_get_ex(parse, "nextPageToken", &nextPageToken);
     if(fileArray)
     {
         size_t arrayLength = json_object_array_length(fileArray);
-        _drvl.reserve(_drvl.size() + arrayLength);
         for(unsigned i = 0; i < arrayLength; i++)
-        {
-            json_object *idString, *nameString, *mimeTypeString, *size, *parentArray;
-            json_object *curFile = json_object_array_get_idx(fileArray, i);
-            json_object_object_get_ex(curFile, "id", &idString);
-            json_object_object_get_ex(curFile, "name", &nameString);
-            json_object_object_get_ex(curFile, "mimeType", &mimeTypeString);
-            json_object_object_get_ex(curFile, "size", &size);
-            json_object_object_get_ex(curFile, "parents", &parentArray);
-
-            rfs::RfsItem newDirItem;
-            newDirItem.name = json_object_get_string(nameString);
-            newDirItem.id = json_object_get_string(idString);
-            newDirItem.size = json_object_get_int(size);
-            if(strcmp(json_object_get_string(mimeTypeString), MIMETYPE_FOLDER) == 0)
-                newDirItem.isDir = true;
-
-            if (parentArray)
-            {
-                size_t parentCount = json_object_array_length(parentArray);
-                //There can only be 1 parent, but it's held in an array...
-                for (unsigned j = 0; j < parentCount; j++)
-                {
-                    json_object *parent = json_object_array_get_idx(parentArray, j);
-                    newDirItem.parent = json_object_get_string(parent);
-                }
-            }
-            _drvl.push_back(newDirItem);
-        }
+            listItemAdd(parseFileItem(json_object_array_get_idx(fileArray, i)));
     }
+
+    if(nextPageToken)
+        nextPage = json_object_get_string(nextPageToken);
+
     json_object_put(parse);
+    return nextPage;
 }
 
-void drive::gd::driveListInit(const std::string& _q)
+void drive::gd::driveListFetch(const std::string& _q, const std::string& _function)
 {
-    if(!tokenIsValid())
-        refreshToken();
-
     // Request url with specific fields needed.
     std::string url = std::string(driveURL) + std::string(DRIVE_DEFAULT_PARAMS_AND_QUERY);
     if(!_q.empty())
@@ -260,68 +446,181 @@ void drive::gd::driveListInit(const std::string& _q)
         url.append(std::string("\%20and\%20") + std::string(qEsc));
         curl_free(qEsc);
     }
-    
+
+    //Drive caps pages at 1000 files, so keep going until there's no nextPageToken
+    std::string pageToken;
+    do
+    {
+        std::string pageURL = url, jsonResp;
+        if(!pageToken.empty())
+            pageURL.append("&pageToken=" + pageToken);
+
+        int error = requestList(pageURL, &jsonResp);
+        if(error != CURLE_OK)
+        {
+            writeCurlError(_function, error);
+            break;
+        }
+        pageToken = processList(jsonResp);
+    } while(!pageToken.empty());
+}
+
+void drive::gd::driveListInit(const std::string& _q)
+{
+    mutexLock(&syncLock);
+    clearDriveList();
+
+    //Grab the change token first so nothing that happens during the listing gets missed
     std::string jsonResp;
-    int error = requestList(url, token, &jsonResp);
+    int error = requestList(std::string(driveChangesURL) + "/startPageToken", &jsonResp);
     if(error == CURLE_OK)
-        processList(jsonResp, driveList, true);
+    {
+        json_object *parse = json_tokener_parse(jsonResp.c_str()), *startToken = NULL;
+        json_object_object_get_ex(parse, "startPageToken", &startToken);
+        if(startToken)
+            changesToken = json_object_get_string(startToken);
+        json_object_put(parse);
+    }
     else
         writeCurlError("driveListInit", error);
+
+    listQueries.assign(1, _q);
+    driveListFetch(_q, "driveListInit");
+    lastSync = time(NULL);
+    mutexUnlock(&syncLock);
 }
 
 void drive::gd::driveListAppend(const std::string& _q)
 {
-    if(!tokenIsValid())
-        refreshToken();
+    mutexLock(&syncLock);
+    listQueries.push_back(_q);
+    driveListFetch(_q, "driveListAppend");
+    mutexUnlock(&syncLock);
+}
 
-    std::string url = std::string(driveURL) + std::string(DRIVE_DEFAULT_PARAMS_AND_QUERY); 
-    if(!_q.empty())
+void drive::gd::driveListUpdate()
+{
+    mutexLock(&syncLock);
+    driveListSync();
+    mutexUnlock(&syncLock);
+}
+
+void drive::gd::driveListSync()
+{
+    //The changes feed can't apply a query, so a filtered list is listed again instead of picking up files the filter would have left out
+    bool filtered = false;
+    for(const std::string& q : listQueries)
+        filtered = filtered || !q.empty();
+
+    if(filtered)
     {
-        char *qEsc = curl_easy_escape(NULL, _q.c_str(), _q.length());
-        url.append(std::string("\%20and\%20") + std::string(qEsc));
-        curl_free(qEsc);
+        clearDriveList();
+        for(const std::string& q : listQueries)
+            driveListFetch(q, "driveListUpdate");
+        lastSync = time(NULL);
+        return;
     }
 
-    std::string jsonResp;
-    int error = requestList(url, token, &jsonResp);
-    if(error == CURLE_OK)
-        processList(jsonResp, driveList, false);
-    else
-        writeCurlError("driveListAppend", error);
+    if(changesToken.empty())
+        return;
+
+    std::string pageToken = changesToken;
+    while(!pageToken.empty())
+    {
+        std::string jsonResp;
+        int error = requestList(std::string(driveChangesURL) + "?pageToken=" + pageToken + DRIVE_CHANGES_PARAMS, &jsonResp);
+        if(error != CURLE_OK)
+        {
+            writeCurlError("driveListUpdate", error);
+            return;
+        }
+
+        json_object *parse = json_tokener_parse(jsonResp.c_str()), *changeArray = NULL, *nextPage = NULL, *newStart = NULL;
+        json_object_object_get_ex(parse, "changes", &changeArray);
+        json_object_object_get_ex(parse, "nextPageToken", &nextPage);
+        json_object_object_get_ex(parse, "newStartPageToken", &newStart);
+        if(changeArray)
+        {
+            size_t changeCount = json_object_array_length(changeArray);
+            for(unsigned i = 0; i < changeCount; i++)
+            {
+                json_object *change = json_object_array_get_idx(changeArray, i), *fileID = NULL, *removed = NULL, *file = NULL;
+                json_object_object_get_ex(change, "fileId", &fileID);
+                json_object_object_get_ex(change, "removed", &removed);
+                json_object_object_get_ex(change, "file", &file);
+                if(!fileID)
+                    continue;
+
+                json_object *trashed = NULL, *ownedByMe = NULL;
+                if(file)
+                {
+                    json_object_object_get_ex(file, "trashed", &trashed);
+                    json_object_object_get_ex(file, "ownedByMe", &ownedByMe);
+                }
+
+                //Same filter the full listing uses
+                bool gone = (removed && json_object_get_boolean(removed)) || !file || (trashed && json_object_get_boolean(trashed)) || (ownedByMe && !json_object_get_boolean(ownedByMe));
+                if(gone)
+                    listItemRemove(json_object_get_string(fileID));
+                else
+                    listItemAdd(parseFileItem(file));
+            }
+        }
+
+        if(newStart)
+        {
+            changesToken = json_object_get_string(newStart);
+            pageToken.clear();
+        }
+        else if(nextPage)
+            pageToken = json_object_get_string(nextPage);
+        else
+            pageToken.clear();
+
+        json_object_put(parse);
+    }
+    lastSync = time(NULL);
 }
 
 std::vector<rfs::RfsItem> drive::gd::getListWithParent(const std::string& _parent) {
+    //If another thread is already syncing, the list is used as it is now instead of waiting on it
+    if(mutexTryLock(&syncLock))
+    {
+        if(time(NULL) - lastSync >= DRIVE_SYNC_INTERVAL)
+            driveListSync();
+        mutexUnlock(&syncLock);
+    }
+
     std::vector<rfs::RfsItem> filtered;
-    for(unsigned i = 0; i < driveList.size(); i++)
+    rmutexLock(&listLock);
+    auto findParent = driveChildren.find(_parent);
+    if(findParent != driveChildren.end())
     {
-        if(driveList[i].parent == _parent)
-            filtered.push_back(driveList[i]);
+        filtered.reserve(findParent->second.size());
+        for(const std::string& id : findParent->second)
+            filtered.push_back(driveItems[id]);
     }
+    rmutexUnlock(&listLock);
     return filtered;
 }
 
 void drive::gd::debugWriteList()
 {
-    for(auto& di : driveList)
+    rmutexLock(&listLock);
+    for(auto& d : driveItems)
     {
+        rfs::RfsItem& di = d.second;
         fs::logWrite("%s\n\t%s\n", di.name.c_str(), di.id.c_str());
         if(!di.parent.empty())
             fs::logWrite("\t%s\n", di.parent.c_str());
     }
+    rmutexUnlock(&listLock);
 }
 
 bool drive::gd::createDir(const std::string& _dirName, const std::string& _parent)
 {
-    if(!tokenIsValid())
-        refreshToken();
-
     bool ret = true;
 
-    // Headers to use
-    curl_slist *postHeaders = NULL;
-    postHeaders = curl_slist_append(postHeaders, std::string(HEADER_AUTHORIZATION + token).c_str());
-    postHeaders = curl_slist_append(postHeaders, HEADER_CONTENT_TYPE_APP_JSON);
-
     // JSON To Post
     json_object *post = json_object_new_object();
     json_object *nameString = json_object_new_string(_dirName.c_str());
@@ -338,15 +637,14 @@ bool drive::gd::createDir(const std::string& _dirName, const std::string& _paren
 
     // Curl Request
     std::string *jsonResp = new std::string;
-    CURL *curl = curl_easy_init();
+    CURL *curl = curlFuncs::borrowHandle();
     curl_easy_setopt(curl, CURLOPT_HTTPPOST, 1);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, postHeaders);
     curl_easy_setopt(curl, CURLOPT_URL, driveURL);
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, jsonResp);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_object_get_string(post));
-    int error = curl_easy_perform(curl);
+    int error = performWithAuth(curl, {HEADER_CONTENT_TYPE_APP_JSON}, jsonResp, NULL);
     
     json_object *respParse = json_tokener_parse(jsonResp->c_str()), *checkError;
     json_object_object_get_ex(respParse, "error", &checkError);
@@ -362,7 +660,7 @@ bool drive::gd::createDir(const std::string& _dirName, const std::string& _paren
         newDir.isDir = true;
         newDir.size = 0;
         newDir.parent = _parent;
-        driveList.push_back(newDir);
+        listItemAdd(newDir);
     }
     else
         ret = false;
@@ -370,55 +668,44 @@ bool drive::gd::createDir(const std::string& _dirName, const std::string& _paren
     delete jsonResp;
     json_object_put(post);
     json_object_put(respParse);
-    curl_slist_free_all(postHeaders);
-    curl_easy_cleanup(curl);
+    curlFuncs::returnHandle(curl);
     return ret;
 }
 
 bool drive::gd::dirExists(const std::string& _dirName)
 {
-    for(unsigned i = 0; i < driveList.size(); i++)
-    {
-        if(driveList[i].isDir && driveList[i].name == _dirName)
-            return true;
-    }
-    return false;
+    return !getDirID(_dirName).empty();
 }
 
 bool drive::gd::dirExists(const std::string& _dirName, const std::string& _parent)
 {
-    for(unsigned i = 0; i < driveList.size(); i++)
-    {
-        if(driveList[i].isDir && driveList[i].name == _dirName && driveList[i].parent == _parent)
-            return true;
-    }
-    return false;
+    rmutexLock(&listLock);
+    bool ret = dirIndex.find(indexKey(_parent, _dirName)) != dirIndex.end();
+    rmutexUnlock(&listLock);
+    return ret;
 }
 
 bool drive::gd::fileExists(const std::string& _filename, const std::string& _parent)
 {
-    for(unsigned i = 0; i < driveList.size(); i++)
-    {
-        if(!driveList[i].isDir && driveList[i].name == _filename && driveList[i].parent == _parent)
-            return true;
-    }
-    return false;
+    rmutexLock(&listLock);
+    bool ret = fileIndex.find(indexKey(_parent, _filename)) != fileIndex.end();
+    rmutexUnlock(&listLock);
+    return ret;
 }
 
-void drive::gd::uploadFile(const std::string& _filename, const std::string& _parent, curlFuncs::curlUpArgs *_upload)
+//New files POST their metadata, existing ones are PATCHed by ID
+static std::string uploadSessionURL(const std::string& _fileID)
 {
-    if(!tokenIsValid())
-        refreshToken();
-
     std::string url = driveUploadURL;
-    url.append("?uploadType=resumable");
-
-    // Headers
-    curl_slist *postHeaders = NULL;
-    postHeaders = curl_slist_append(postHeaders, std::string(HEADER_AUTHORIZATION + token).c_str());
-    postHeaders = curl_slist_append(postHeaders, HEADER_CONTENT_TYPE_APP_JSON);
+    if(!_fileID.empty())
+        url.append("/" + _fileID);
+    //Ask for the checksum back so the list can be updated without another request
+    url.append("?uploadType=resumable&fields=id,name,mimeType,sha256Checksum");
+    return url;
+}
 
-    // Post JSON
+static json_object *uploadMetadata(const std::string& _filename, const std::string& _parent)
+{
     json_object *post = json_object_new_object();
     json_object *nameString = json_object_new_string(_filename.c_str());
     json_object_object_add(post, "name", nameString);
@@ -429,218 +716,302 @@ void drive::gd::uploadFile(const std::string& _filename, const std::string& _par
         json_object_array_add(parentArray, parentString);
         json_object_object_add(post, "parents", parentArray);
     }
+    return post;
+}
 
-    // Curl upload request
-    std::string *jsonResp = new std::string;
-    std::vector<std::string> *headers = new std::vector<std::string>;
-    CURL *curl = curl_easy_init();
-    curl_easy_setopt(curl, CURLOPT_HTTPPOST, 1);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, postHeaders);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlFuncs::writeHeaders);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, headers);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_object_get_string(post));
-    
-    int error = curl_easy_perform(curl);
-    std::string location = curlFuncs::getHeader("Location", headers);
-    if (error == CURLE_OK && location != HEADER_ERROR)
+void drive::gd::uploadFinish(const std::string& _json, const std::string& _parent, const std::string& _fileID, uint64_t _size)
+{
+    json_object *parse = json_tokener_parse(_json.c_str()), *id = NULL, *name = NULL, *mimeType = NULL, *checksum = NULL;
+    json_object_object_get_ex(parse, "id", &id);
+    json_object_object_get_ex(parse, "name", &name);
+    json_object_object_get_ex(parse, "mimeType", &mimeType);
+    json_object_object_get_ex(parse, "sha256Checksum", &checksum);
+
+    if(!_fileID.empty())
     {
-        CURL *curlUp = curl_easy_init();
-        curl_easy_setopt(curlUp, CURLOPT_PUT, 1);
-        curl_easy_setopt(curlUp, CURLOPT_URL, location.c_str());
-        curl_easy_setopt(curlUp, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
-        curl_easy_setopt(curlUp, CURLOPT_WRITEDATA, jsonResp);
-        curl_easy_setopt(curlUp, CURLOPT_READFUNCTION, curlFuncs::readDataFile);
-        curl_easy_setopt(curlUp, CURLOPT_READDATA, _upload);
-        curl_easy_setopt(curlUp, CURLOPT_UPLOAD_BUFFERSIZE, UPLOAD_BUFFER_SIZE);
-        curl_easy_setopt(curlUp, CURLOPT_UPLOAD, 1);
-        curl_easy_perform(curlUp);
-        curl_easy_cleanup(curlUp);
-
-        json_object *parse = json_tokener_parse(jsonResp->c_str()), *id, *name, *mimeType;
-        json_object_object_get_ex(parse, "id", &id);
-        json_object_object_get_ex(parse, "name", &name);
-        json_object_object_get_ex(parse, "mimeType", &mimeType);
-
-        if(name && id && mimeType)
+        rmutexLock(&listLock);
+        auto findItem = driveItems.find(_fileID);
+        if(findItem != driveItems.end())
         {
-            rfs::RfsItem uploadData;
-            uploadData.id = json_object_get_string(id);
-            uploadData.name = json_object_get_string(name);
-            uploadData.isDir = false;
-            uploadData.size = *_upload->o;//should be safe to use
-            uploadData.parent = _parent;
-            driveList.push_back(uploadData);
+            findItem->second.size = _size;
+            findItem->second.checksum = checksum ? json_object_get_string(checksum) : "";
         }
-        json_object_put(parse);
+        rmutexUnlock(&listLock);
+    }
+    else if(name && id && mimeType)
+    {
+        rfs::RfsItem uploadData;
+        uploadData.id = json_object_get_string(id);
+        uploadData.name = json_object_get_string(name);
+        uploadData.isDir = false;
+        uploadData.size = _size;
+        uploadData.parent = _parent;
+        if(checksum)
+            uploadData.checksum = json_object_get_string(checksum);
+        listItemAdd(uploadData);
     }
     else
-        writeCurlError("uploadFile", error);
+        writeDriveError("uploadFinish", _json);
+    json_object_put(parse);
+}
 
-    delete jsonResp;
-    delete headers;
-    json_object_put(post);
-    curl_slist_free_all(postHeaders);
+//Range header Drive sends with 308 is the last byte it has. No header means it has nothing.
+static uint64_t getCommittedBytes(std::vector<std::string> *_headers)
+{
+    std::string range = curlFuncs::getHeader("Range", _headers);
+    if(range == HEADER_ERROR)
+        range = curlFuncs::getHeader("range", _headers);
+
+    size_t dash = range.find_last_of('-');
+    if(range == HEADER_ERROR || dash == range.npos)
+        return 0;
+
+    return strtoull(range.substr(dash + 1).c_str(), NULL, 10) + 1;
 }
 
-void drive::gd::updateFile(const std::string& _fileID, curlFuncs::curlUpArgs *_upload)
+//Same session transferMngr runs for everything else, for callers that only have the file open
+void drive::gd::uploadFile(const std::string& _filename, const std::string& _parent, curlFuncs::curlUpArgs *_upload)
 {
-    if(!tokenIsValid())
-        refreshToken();
+    rfs::transferMngr upload(this, 1, 0);
+    upload.addUpload(_upload->f, _filename, _parent, "");
+    upload.run(NULL);
+    if(_upload->o)
+        *_upload->o = upload.getTotalTransferred();
+}
 
-    //URL
-    std::string url = driveUploadURL;
-    url.append("/" + _fileID);
-    url.append("?uploadType=resumable");
+void drive::gd::updateFile(const std::string& _fileID, curlFuncs::curlUpArgs *_upload)
+{
+    rfs::transferMngr upload(this, 1, 0);
+    upload.addUpload(_upload->f, _fileID, "", _fileID);
+    upload.run(NULL);
+    if(_upload->o)
+        *_upload->o = upload.getTotalTransferred();
+}
 
-    //Header
-    curl_slist *patchHeader = NULL;
-    patchHeader = curl_slist_append(patchHeader, std::string(HEADER_AUTHORIZATION + token).c_str());
+//Uploads go one request at a time: open the session, send it UPLOAD_CHUNK_SIZE at a time
+//and ask it where it's at after a failure. finishTransfer decides what's next.
+bool drive::gd::prepareUpload(CURL *_curl, rfs::transferItem *_item)
+{
+    if(_item->session.empty())
+    {
+        _item->headers = curl_slist_append(_item->headers, std::string(HEADER_AUTHORIZATION + getToken()).c_str());
+        if(_item->id.empty())
+        {
+            json_object *post = uploadMetadata(_item->name, _item->parent);
+            _item->headers = curl_slist_append(_item->headers, HEADER_CONTENT_TYPE_APP_JSON);
+            curl_easy_setopt(_curl, CURLOPT_COPYPOSTFIELDS, json_object_get_string(post));
+            json_object_put(post);
+        }
+        else
+            curl_easy_setopt(_curl, CURLOPT_CUSTOMREQUEST, "PATCH");
 
-    //Curl
-    std::string *jsonResp = new std::string;
-    std::vector<std::string> *headers = new std::vector<std::string>;
-    CURL *curl = curl_easy_init();
-    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PATCH");
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, patchHeader);
-    curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlFuncs::writeHeaders);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, jsonResp);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, headers);
-    
-    int error = curl_easy_perform(curl);
-    std::string location = curlFuncs::getHeader("Location", headers);
-    if(error == CURLE_OK && location != HEADER_ERROR)
+        curl_easy_setopt(_curl, CURLOPT_URL, uploadSessionURL(_item->id).c_str());
+        _item->sendFrom = _item->sendTo = 0;
+    }
+    else if(_item->query)
+    {
+        _item->headers = curl_slist_append(_item->headers, std::string("Content-Range: bytes */" + std::to_string(_item->size)).c_str());
+        curl_easy_setopt(_curl, CURLOPT_URL, _item->session.c_str());
+        curl_easy_setopt(_curl, CURLOPT_UPLOAD, 1);
+        _item->sendFrom = _item->sendTo = _item->committed;
+    }
+    else
     {
-        CURL *curlPatch = curl_easy_init();
-        curl_easy_setopt(curlPatch, CURLOPT_PUT, 1);
-        curl_easy_setopt(curlPatch, CURLOPT_URL, location.c_str());
-        curl_easy_setopt(curlPatch, CURLOPT_READFUNCTION, curlFuncs::readDataFile);
-        curl_easy_setopt(curlPatch, CURLOPT_READDATA, _upload);
-        curl_easy_setopt(curlPatch, CURLOPT_UPLOAD_BUFFERSIZE, UPLOAD_BUFFER_SIZE);
-        curl_easy_setopt(curlPatch, CURLOPT_UPLOAD, 1);
-        curl_easy_perform(curlPatch);
-        curl_easy_cleanup(curlPatch);
-
-        for(unsigned i = 0; i < driveList.size(); i++)
+        _item->sendFrom = _item->committed;
+        _item->sendTo = _item->size - _item->committed < UPLOAD_CHUNK_SIZE ? _item->size : _item->committed + UPLOAD_CHUNK_SIZE;
+        if(_item->sendTo > _item->sendFrom)
         {
-            if(driveList[i].id == _fileID)
-            {
-                driveList[i].size = *_upload->o;
-                break;
-            }
+            std::string range = "Content-Range: bytes " + std::to_string(_item->sendFrom) + "-" + std::to_string(_item->sendTo - 1) + "/" + std::to_string(_item->size);
+            _item->headers = curl_slist_append(_item->headers, range.c_str());
         }
+        curl_easy_setopt(_curl, CURLOPT_URL, _item->session.c_str());
+        curl_easy_setopt(_curl, CURLOPT_UPLOAD, 1);
     }
-
-    delete jsonResp;
-    delete headers;
-    curl_slist_free_all(patchHeader);
-    curl_easy_cleanup(curl);
+    curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, _item->headers);
+    return true;
 }
 
-void drive::gd::downloadFile(const std::string& _fileID, curlFuncs::curlDlArgs *_download)
+//Waits longer each time and asks the session where it's at. Gives up after UPLOAD_MAX_RETRIES
+static void uploadRetry(rfs::transferItem *_item)
 {
-    if(!tokenIsValid())
-        refreshToken();
+    if(_item->retries >= UPLOAD_MAX_RETRIES)
+    {
+        writeDriveError("finishTransfer", "Giving up on " + _item->name + " after " + std::to_string(_item->retries) + " retries.");
+        _item->success = false;
+        return;
+    }
 
-    //URL
+    _item->query = !_item->session.empty();
+    _item->retryAt = armGetSystemTick() + (armGetSystemTickFreq() << _item->retries++);
+    _item->again = true;
+}
+
+bool drive::gd::prepareDownload(CURL *_curl, rfs::transferItem *_item)
+{
     std::string url = driveURL;
-    url.append("/" + _fileID);
+    url.append("/" + _item->id);
     url.append("?alt=media");
 
-    //Headers
-    curl_slist *getHeaders = NULL;
-    getHeaders = curl_slist_append(getHeaders, std::string(HEADER_AUTHORIZATION + token).c_str());
+    _item->headers = curl_slist_append(_item->headers, std::string(HEADER_AUTHORIZATION + getToken()).c_str());
+    curl_easy_setopt(_curl, CURLOPT_HTTPGET, 1);
+    curl_easy_setopt(_curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(_curl, CURLOPT_HTTPHEADER, _item->headers);
+    return true;
+}
+
+void drive::gd::finishTransfer(CURL *_curl, rfs::transferItem *_item, bool _success)
+{
+    if(_item->type != rfs::TRANSFER_UPLOAD)
+        return;
 
-    //Downloading is threaded because it's too slow otherwise
-    rfs::dlWriteThreadStruct dlWrite;
-    dlWrite.cfa = _download;
+    long respCode = 0;
+    curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &respCode);
 
-    Thread writeThread;
-    threadCreate(&writeThread, rfs::writeThread_t, &dlWrite, NULL, 0x8000, 0x2B, 2);
+    if(_item->session.empty())
+    {
+        std::string location = curlFuncs::getHeader("Location", &_item->respHeaders);
+        if(location == HEADER_ERROR)
+            location = curlFuncs::getHeader("location", &_item->respHeaders);
 
-    //Curl
-    CURL *curl = curl_easy_init();
+        if(_success && location != HEADER_ERROR)
+        {
+            _item->session = location;
+            _item->committed = 0;
+            _item->again = true;
+        }
+        else
+        {
+            writeDriveError("finishTransfer", "Couldn't start upload session for " + _item->name + ". HTTP " + std::to_string(respCode));
+            uploadRetry(_item);
+        }
+        return;
+    }
+
+    if(respCode == 200 || respCode == 201)
+    {
+        uploadFinish(_item->response, _item->parent, _item->id, _item->size);
+        _item->offset = _item->size;
+        return;
+    }
+    else if(respCode == 404 || respCode == 410)
+    {
+        //Start over with a new session
+        writeDriveError("finishTransfer", "Upload session for " + _item->name + " expired.");
+        _item->session.clear();
+        _item->committed = 0;
+        uploadRetry(_item);
+        return;
+    }
+
+    //Drive can take less than what was sent. A query answers with wherever it's at. A 308 that doesn't move forward counts as a failure
+    uint64_t committed = respCode == 308 ? getCommittedBytes(&_item->respHeaders) : 0;
+    if(respCode == 308 && (_item->query || committed > _item->committed))
+    {
+        if(!_item->query)
+            _item->retries = 0;
+
+        _item->committed = committed;
+        _item->offset = committed;
+        _item->query = false;
+        _item->again = true;
+        return;
+    }
+
+    writeDriveError("finishTransfer", "HTTP " + std::to_string(respCode) + " uploading " + _item->name + " at " + std::to_string(_item->committed));
+    uploadRetry(_item);
+}
+
+std::string drive::gd::getChecksum(const std::string& _fileID)
+{
+    //Listing and uploads already keep this up to date
+    rmutexLock(&listLock);
+    auto findItem = driveItems.find(_fileID);
+    std::string cached = findItem != driveItems.end() ? findItem->second.checksum : "";
+    rmutexUnlock(&listLock);
+    if(!cached.empty())
+        return cached;
+
+    std::string url = driveURL;
+    url.append("/" + _fileID);
+    url.append("?fields=sha256Checksum");
+
+    std::string jsonResp;
+    CURL *curl = curlFuncs::borrowHandle();
     curl_easy_setopt(curl, CURLOPT_HTTPGET, 1);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, getHeaders);
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, rfs::writeDataBufferThreaded);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &dlWrite);
-    threadStart(&writeThread);
-    
-    curl_easy_perform(curl);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &jsonResp);
+    int error = performWithAuth(curl, {}, &jsonResp, NULL);
+    curlFuncs::returnHandle(curl);
 
-    threadWaitForExit(&writeThread);
-    threadClose(&writeThread);
+    std::string ret;
+    if(error == CURLE_OK)
+    {
+        json_object *parse = json_tokener_parse(jsonResp.c_str()), *checksum = NULL;
+        if(json_object_object_get_ex(parse, "sha256Checksum", &checksum))
+            ret = json_object_get_string(checksum);
+        json_object_put(parse);
+    }
+    else
+        writeCurlError("getChecksum", error);
 
-    curl_slist_free_all(getHeaders);
-    curl_easy_cleanup(curl);
+    return ret;
 }
 
 void drive::gd::deleteFile(const std::string& _fileID)
 {
-    if(!tokenIsValid())
-        refreshToken();
-
     //URL
     std::string url = driveURL;
     url.append("/" + _fileID);
 
-    //Header
-    curl_slist *delHeaders = NULL;
-    delHeaders = curl_slist_append(delHeaders, std::string(HEADER_AUTHORIZATION + token).c_str());
-
     //Curl
-    CURL *curl = curl_easy_init();
+    CURL *curl = curlFuncs::borrowHandle();
     curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "DELETE");
     curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, delHeaders);
     curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_perform(curl);
+    performWithAuth(curl, {}, NULL, NULL);
 
-    for(unsigned i = 0; i < driveList.size(); i++)
-    {
-        if(driveList[i].id == _fileID)
-        {
-            driveList.erase(driveList.begin() + i);
-            break;
-        }
-    }
+    listItemRemove(_fileID);
 
-    curl_slist_free_all(delHeaders);
-    curl_easy_cleanup(curl);
+    curlFuncs::returnHandle(curl);
 }
 
 std::string drive::gd::getFileID(const std::string& _name, const std::string& _parent)
 {
-    for(unsigned i = 0; i < driveList.size(); i++)
-    {
-        if(!driveList[i].isDir && driveList[i].name == _name && driveList[i].parent == _parent)
-            return driveList[i].id;
-    }
-    return "";
+    std::string ret;
+    rmutexLock(&listLock);
+    auto findFile = fileIndex.find(indexKey(_parent, _name));
+    if(findFile != fileIndex.end())
+        ret = findFile->second;
+    rmutexUnlock(&listLock);
+    return ret;
 }
 
 std::string drive::gd::getDirID(const std::string& _name)
 {
-    for(unsigned i = 0; i < driveList.size(); i++)
+    //Only used once at startup to find the JKSV folder, so a scan is fine here
+    std::string ret;
+    rmutexLock(&listLock);
+    for(auto& d : driveItems)
     {
-        if(driveList[i].isDir && driveList[i].name == _name)
-            return driveList[i].id;
+        if(d.second.isDir && d.second.name == _name)
+        {
+            ret = d.first;
+            break;
+        }
     }
-    return "";
+    rmutexUnlock(&listLock);
+    return ret;
 }
 
 std::string drive::gd::getDirID(const std::string& _name, const std::string& _parent)
 {
-    for(unsigned i = 0; i < driveList.size(); i++)
-    {
-        if(driveList[i].isDir && driveList[i].name == _name && driveList[i].parent == _parent)
-            return driveList[i].id;
-    }
-    return "";
-}
\ No newline at end of file
+    std::string ret;
+    rmutexLock(&listLock);
+    auto findDir = dirIndex.find(indexKey(_parent, _name));
+    if(findDir != dirIndex.end())
+        ret = findDir->second;
+    rmutexUnlock(&listLock);
+    return ret;
+}
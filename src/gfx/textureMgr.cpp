@@ -42,73 +42,76 @@ SDL_Texture *gfx::textureMgr::textureLoadFromFile(const char *_path)
     return ret;
 }
 
-static SDL_Texture *loadPNGMem(const void *_dat, size_t _datSize)
+SDL_Surface *gfx::surfaceLoadFromMem(imgTypes _type, const void *_dat, size_t _datSize)
 {
-    SDL_Texture *ret = NULL;
-    SDL_RWops *pngData = SDL_RWFromConstMem(_dat, _datSize);
-    SDL_Surface *tmp = IMG_LoadPNG_RW(pngData);
-    if(tmp)
+    SDL_Surface *ret = NULL;
+    SDL_RWops *imgData = SDL_RWFromConstMem(_dat, _datSize);
+    switch (_type)
     {
-        ret = SDL_CreateTextureFromSurface(gfx::render, tmp);
-        SDL_FreeSurface(tmp);
-        SDL_SetTextureBlendMode(ret, SDL_BLENDMODE_BLEND);
+        case IMG_FMT_PNG:
+            ret = IMG_LoadPNG_RW(imgData);
+            break;
+
+        case IMG_FMT_JPG:
+            ret = IMG_LoadJPG_RW(imgData);
+            break;
+
+        case IMG_FMT_BMP:
+            ret = IMG_LoadBMP_RW(imgData);
+            break;
     }
-    SDL_RWclose(pngData);
+    SDL_RWclose(imgData);
     return ret;
 }
 
-static SDL_Texture *loadJPEGMem(const void *_dat, size_t _datSize)
+SDL_Surface *gfx::surfaceResize(SDL_Surface *_surf, int _w, int _h)
 {
-    SDL_Texture *ret = NULL;
-    SDL_RWops *jpegData = SDL_RWFromConstMem(_dat, _datSize);
-    SDL_Surface *tmp = IMG_LoadJPG_RW(jpegData);
-    if(tmp)
+    if(!_surf)
+        return NULL;
+
+    SDL_Surface *conv = SDL_ConvertSurfaceFormat(_surf, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(_surf);
+    if(!conv || (conv->w == _w && conv->h == _h))
+        return conv;
+
+    SDL_Surface *ret = SDL_CreateRGBSurfaceWithFormat(0, _w, _h, 32, SDL_PIXELFORMAT_RGBA32);
+    if(ret && SDL_SoftStretchLinear(conv, NULL, ret, NULL) != 0)
     {
-        ret = SDL_CreateTextureFromSurface(gfx::render, tmp);
-        SDL_FreeSurface(tmp);
-        SDL_SetTextureBlendMode(ret, SDL_BLENDMODE_BLEND);
+        SDL_FreeSurface(ret);
+        ret = NULL;
     }
-    SDL_RWclose(jpegData);
+    SDL_FreeSurface(conv);
     return ret;
 }
 
-static SDL_Texture *loadBMPMem(const void *_dat, size_t _datSize)
+SDL_Texture *gfx::textureMgr::textureLoadFromSurface(SDL_Surface *_surf)
 {
-    SDL_Texture *ret = NULL;
-    SDL_RWops *bmpData = SDL_RWFromConstMem(_dat, _datSize);
-    SDL_Surface *tmp = IMG_LoadBMP_RW(bmpData);
-    if(tmp)
+    if(!_surf)
+        return NULL;
+
+    SDL_Texture *ret = SDL_CreateTextureFromSurface(gfx::render, _surf);
+    SDL_FreeSurface(_surf);
+    if(ret)
     {
-        ret = SDL_CreateTextureFromSurface(gfx::render, tmp);
-        SDL_FreeSurface(tmp);
         SDL_SetTextureBlendMode(ret, SDL_BLENDMODE_BLEND);
+        textures.push_back(ret);
     }
-    SDL_RWclose(bmpData);
     return ret;
 }
 
 SDL_Texture *gfx::textureMgr::textureLoadFromMem(imgTypes _type, const void *_dat, size_t _datSize)
 {
-    SDL_Texture *ret = NULL;
-    switch (_type)
-    {
-        case IMG_FMT_PNG:
-            ret = loadPNGMem(_dat, _datSize);
-            break;
-
-        case IMG_FMT_JPG:
-            ret = loadJPEGMem(_dat, _datSize);
-            break;
+    return textureLoadFromSurface(surfaceLoadFromMem(_type, _dat, _datSize));
+}
 
-        case IMG_FMT_BMP:
-            ret = loadBMPMem(_dat, _datSize);
-            break;
+void gfx::textureMgr::textureDestroy(SDL_Texture *_tex)
+{
+    auto texIt = std::find(textures.begin(), textures.end(), _tex);
+    if(texIt != textures.end())
+    {
+        SDL_DestroyTexture(*texIt);
+        textures.erase(texIt);
     }
-
-    if(ret)
-        textures.push_back(ret);
-
-    return ret;
 }
 
 void gfx::textureMgr::textureResize(SDL_Texture **_tex, int _w, int _h)
@@ -7,6 +7,7 @@
 #include "ui.h"
 #include "util.h"
 #include "cfg.h"
+#include "curlfuncs.h"
 
 extern "C"
 {
@@ -50,16 +51,24 @@ int main(int argc, const char *argv[])
     ui::init();
     romfsExit();
 
+    if(cfg::config["trashBin"])
+        fs::trashPurgeThreaded();
+
     curl_global_init(CURL_GLOBAL_ALL);
+    curlFuncs::poolInit();
     //Drive needs config read
     if(!util::isApplet())
         fs::remoteInit();
     else
         ui::showMessage(ui::getUICString("appletModeWarning", 0));
+    //Picks up anything left from last time
+    fs::remoteQueueInit();
         
     while(ui::runApp()){ }
 
+    fs::remoteQueueExit();
     fs::remoteExit();
+    curlFuncs::poolExit();
     curl_global_cleanup();
     ui::exit();
     data::exit();
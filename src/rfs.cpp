@@ -1,51 +1,664 @@
+#include <algorithm>
+#include <zlib.h>
+
 #include "rfs.h"
+#include "fs.h"
+
+//Wait this long before retrying a download that failed partway. Doubles each time.
+#define DOWNLOAD_RETRY_WAIT 1
+#define DOWNLOAD_MAX_RETRIES 5
+#define GZIP_BUFFER_SIZE 0x80000
+#define GZIP_SAMPLE_SIZE 0x40000
+//Compressed sample has to be under this percent of the original for the file to be gzipped
+#define GZIP_MIN_SAVING 90
 
-std::vector<uint8_t> rfs::downloadBuffer;
+void rfs::writeThreadInit(dlWriteThreadStruct *in, curlFuncs::curlDlArgs *_cfa, uint64_t _offset)
+{
+    in->cfa = _cfa;
+    in->offset = _offset;
+    in->fillBuffer.reserve(DOWNLOAD_BUFFER_SIZE);
+    in->writeBuffer.reserve(DOWNLOAD_BUFFER_SIZE);
+}
 
 void rfs::writeThread_t(void *a)
 {
     rfs::dlWriteThreadStruct *in = (rfs::dlWriteThreadStruct *)a;
-    std::vector<uint8_t> localBuff;
-    unsigned written = 0;
 
-    FILE *out = fopen(in->cfa->path.c_str(), "wb");
+    FILE *out = fopen(in->cfa->path.c_str(), in->offset > 0 ? "ab" : "wb");
 
-    while(written < in->cfa->size)
+    while(true)
     {
         std::unique_lock<std::mutex> dataLock(in->dataLock);
-        in->cond.wait(dataLock, [in]{ return in->bufferFull; });
-        localBuff.clear();
-        localBuff.assign(in->sharedBuffer.begin(), in->sharedBuffer.end());
-        in->sharedBuffer.clear();
+        in->cond.wait(dataLock, [in]{ return in->bufferFull || in->finished; });
+        if(!in->bufferFull)
+            break;
+        dataLock.unlock();
+
+        //writeBuffer belongs to this thread until bufferFull is cleared
+        if(out)
+            fwrite(in->writeBuffer.data(), 1, in->writeBuffer.size(), out);
+
+        dataLock.lock();
+        in->writeBuffer.clear();
         in->bufferFull = false;
         dataLock.unlock();
         in->cond.notify_one();
+    }
+    if(out)
+        fclose(out);
+}
 
-        written += fwrite(localBuff.data(), 1, localBuff.size(), out);
+//Waits for the write thread to be done with writeBuffer and gives it fillBuffer. Swapping keeps both allocations.
+static void writeThreadHandOff(rfs::dlWriteThreadStruct *in, bool _finish)
+{
+    std::unique_lock<std::mutex> dataLock(in->dataLock);
+    in->cond.wait(dataLock, [in]{ return in->bufferFull == false; });
+    if(!in->fillBuffer.empty())
+    {
+        in->fillBuffer.swap(in->writeBuffer);
+        in->bufferFull = true;
     }
-    fclose(out);
-    rfs::downloadBuffer.clear();
+    in->finished = _finish;
+    dataLock.unlock();
+    in->cond.notify_one();
 }
 
 size_t rfs::writeDataBufferThreaded(uint8_t *buff, size_t sz, size_t cnt, void *u)
 {
     rfs::dlWriteThreadStruct *in = (rfs::dlWriteThreadStruct *)u;
-    rfs::downloadBuffer.insert(rfs::downloadBuffer.end(), buff, buff + (sz * cnt));
-    in->downloaded += sz * cnt;
+    size_t size = sz * cnt;
+    if(in->fillBuffer.size() + size > DOWNLOAD_BUFFER_SIZE)
+        writeThreadHandOff(in, false);
+
+    in->fillBuffer.insert(in->fillBuffer.end(), buff, buff + size);
+    in->downloaded += size;
+
+    if(in->cfa->o)
+        *in->cfa->o = in->offset + in->downloaded;
+
+    return size;
+}
+
+void rfs::writeThreadFinish(dlWriteThreadStruct *in)
+{
+    writeThreadHandOff(in, true);
+}
+
+std::string rfs::fileSha256(const std::string& _path)
+{
+    FILE *f = fopen(_path.c_str(), "rb");
+    if(!f)
+        return "";
+
+    Sha256Context ctx;
+    sha256ContextCreate(&ctx);
 
-    if(in->downloaded == in->cfa->size || rfs::downloadBuffer.size() == DOWNLOAD_BUFFER_SIZE)
+    std::vector<uint8_t> buff(UPLOAD_BUFFER_SIZE * 8);
+    size_t read = 0;
+    while((read = fread(buff.data(), 1, buff.size(), f)) > 0)
+        sha256ContextUpdate(&ctx, buff.data(), read);
+    fclose(f);
+
+    return sha256ToString(&ctx);
+}
+
+std::string rfs::sha256ToString(Sha256Context *_ctx)
+{
+    uint8_t hash[SHA256_HASH_SIZE];
+    sha256ContextGetHash(_ctx, hash);
+
+    char hex[SHA256_HASH_SIZE * 2 + 1];
+    for(unsigned i = 0; i < SHA256_HASH_SIZE; i++)
+        sprintf(&hex[i * 2], "%02x", hash[i]);
+
+    return std::string(hex);
+}
+
+bool rfs::IRemoteFS::remoteMatches(const std::string& _localPath, const std::string& _fileID)
+{
+    if(_fileID.empty())
+        return false;
+
+    std::string remoteHash = getChecksum(_fileID);
+    return !remoteHash.empty() && remoteHash == fileSha256(_localPath);
+}
+
+bool rfs::IRemoteFS::downloadFile(const std::string& _fileID, curlFuncs::curlDlArgs *_download)
+{
+    std::string partPath = _download->path + ".part";
+    curlFuncs::curlDlArgs partArgs = *_download;
+    partArgs.path = partPath;
+
+    bool complete = false;
+    for(unsigned retries = 0; !complete && retries <= DOWNLOAD_MAX_RETRIES; retries++)
     {
-        std::unique_lock<std::mutex> dataLock(in->dataLock);
-        in->cond.wait(dataLock, [in]{ return in->bufferFull == false; });
-        in->sharedBuffer.assign(rfs::downloadBuffer.begin(), rfs::downloadBuffer.end());
-        rfs::downloadBuffer.clear();
-        in->bufferFull = true;
-        dataLock.unlock();
-        in->cond.notify_one();
+        if(retries > 0)
+            svcSleepThread((1000000000LL * DOWNLOAD_RETRY_WAIT) << (retries - 1));
+
+        bool partExists = fs::fileExists(partPath);
+        uint64_t offset = partExists ? fs::fsize(partPath) : 0;
+        if(_download->size == 0)
+        {
+            //Empty or the size isn't known. Nothing to check a part file against, so it's always a full download
+            if(partExists)
+                fs::delfile(partPath);
+            offset = 0;
+        }
+        else if(partExists && offset >= _download->size)
+        {
+            //Either a previous attempt finished but wasn't verified or the file is larger than it should be. Start over if larger.
+            if(offset == _download->size)
+            {
+                complete = true;
+                break;
+            }
+            fs::delfile(partPath);
+            offset = 0;
+        }
+
+        //Downloading is threaded because it's too slow otherwise
+        dlWriteThreadStruct dlWrite;
+        writeThreadInit(&dlWrite, &partArgs, offset);
+
+        transferItem item;
+        item.type = TRANSFER_DOWNLOAD;
+        item.id = _fileID;
+        item.localPath = partPath;
+        item.size = _download->size;
+        item.offset = offset;
+
+        CURL *curl = curlFuncs::borrowHandle();
+        curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
+        if(!prepareDownload(curl, &item))
+        {
+            curl_slist_free_all(item.headers);
+            curlFuncs::returnHandle(curl);
+            continue;
+        }
+
+        //Keeps error bodies out of the file
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
+        curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)offset);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeDataBufferThreaded);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &dlWrite);
+
+        Thread writeThread;
+        threadCreate(&writeThread, writeThread_t, &dlWrite, NULL, 0x8000, 0x2B, 2);
+        threadStart(&writeThread);
+
+        CURLcode res = curl_easy_perform(curl);
+
+        writeThreadFinish(&dlWrite);
+        threadWaitForExit(&writeThread);
+        threadClose(&writeThread);
+
+        long respCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &respCode);
+        curl_slist_free_all(item.headers);
+        curlFuncs::returnHandle(curl);
+
+        if(res == CURLE_OK)
+            complete = _download->size == 0 || fs::fsize(partPath) == _download->size;
+        else
+        {
+            fs::logWrite("downloadFile: %s stopped at %llu. CURL: %i HTTP: %li\n", _download->path.c_str(), (unsigned long long)(offset + dlWrite.downloaded), res, respCode);
+            //Server won't do ranges or the range is bad. Only a full download will work
+            if(res == CURLE_RANGE_ERROR || respCode == 416)
+                fs::delfile(partPath);
+            //Anything else in the 4xx range won't fix itself
+            else if(respCode >= 400 && respCode < 500 && respCode != 408 && respCode != 429)
+                break;
+        }
     }
 
-    if(in->cfa->o)
-        *in->cfa->o = in->downloaded;
+    if(!complete)
+    {
+        //Part file is kept so the next attempt can pick up where this one stopped
+        fs::logWrite("downloadFile: Failed to download %s.\n", _download->path.c_str());
+        return false;
+    }
+
+    std::string remoteHash = getChecksum(_fileID);
+    if(!remoteHash.empty() && remoteHash != fileSha256(partPath))
+    {
+        fs::logWrite("downloadFile: Checksum mismatch for %s.\n", _download->path.c_str());
+        fs::delfile(partPath);
+        return false;
+    }
+
+    if(!finishDownloadFile(partPath, _download->path, _download->gunzip))
+    {
+        fs::logWrite("downloadFile: Failed to unpack %s.\n", _download->path.c_str());
+        return false;
+    }
+
+    if(_download->o)
+        *_download->o = _download->size;
+
+    return true;
+}
+
+bool rfs::gzipForUpload(const std::string& _in, const std::string& _out)
+{
+    FILE *in = fopen(_in.c_str(), "rb");
+    if(!in)
+        return false;
+
+    std::vector<uint8_t> buffer(GZIP_BUFFER_SIZE);
+    size_t sampleSize = fread(buffer.data(), 1, GZIP_SAMPLE_SIZE, in);
+
+    //Zips and anything else that's already compressed won't get smaller. Only a quick level 1 pass on a sample is done to find out.
+    uLongf sampleOut = compressBound(sampleSize);
+    std::vector<uint8_t> sampleBuffer(sampleOut);
+    if(sampleSize == 0 || compress2(sampleBuffer.data(), &sampleOut, buffer.data(), sampleSize, 1) != Z_OK || sampleOut > sampleSize * GZIP_MIN_SAVING / 100)
+    {
+        fclose(in);
+        return false;
+    }
+
+    //No name or time goes in the header, so the same file always gzips to the same bytes and dedup still works
+    gzFile out = gzopen(_out.c_str(), "wb6");
+    if(!out)
+    {
+        fclose(in);
+        return false;
+    }
+
+    bool ok = true;
+    fseek(in, 0, SEEK_SET);
+    size_t read = 0;
+    while(ok && (read = fread(buffer.data(), 1, GZIP_BUFFER_SIZE, in)) > 0)
+        ok = gzwrite(out, buffer.data(), read) == (int)read;
+
+    fclose(in);
+    ok = gzclose(out) == Z_OK && ok;
+    if(!ok)
+        fs::delfile(_out);
+
+    return ok;
+}
+
+bool rfs::finishDownloadFile(const std::string& _partPath, const std::string& _path, bool _gunzip)
+{
+    if(fs::fileExists(_path))
+        fs::delfile(_path);
+
+    if(!_gunzip)
+        return rename(_partPath.c_str(), _path.c_str()) == 0;
+
+    gzFile in = gzopen(_partPath.c_str(), "rb");
+    FILE *out = fopen(_path.c_str(), "wb");
+    bool ok = in && out;
+
+    std::vector<uint8_t> buffer(GZIP_BUFFER_SIZE);
+    int read = 0;
+    while(ok && (read = gzread(in, buffer.data(), GZIP_BUFFER_SIZE)) > 0)
+        ok = fwrite(buffer.data(), 1, read, out) == (size_t)read;
+
+    ok = ok && read == 0;
+    if(in)
+        gzclose(in);
+    if(out)
+        fclose(out);
+
+    //Part is kept if unpacking failed so it doesn't have to be downloaded again
+    if(ok)
+        fs::delfile(_partPath);
+    else
+        fs::delfile(_path);
+
+    return ok;
+}
+
+static size_t transferRead(char *buff, size_t sz, size_t cnt, void *u)
+{
+    rfs::transferItem *item = (rfs::transferItem *)u;
+    size_t toRead = sz * cnt;
+    if(toRead > item->sendTo - item->offset)
+        toRead = item->sendTo - item->offset;
+
+    size_t ret = fread(buff, 1, toRead, item->f);
+    item->offset += ret;
+    return ret;
+}
+
+static size_t transferWrite(const char *buff, size_t sz, size_t cnt, void *u)
+{
+    rfs::transferItem *item = (rfs::transferItem *)u;
+    size_t ret = fwrite(buff, 1, sz * cnt, item->f);
+    item->offset += ret;
+    return ret;
+}
+
+rfs::transferMngr::transferMngr(IRemoteFS *_rfs, unsigned _maxConcurrent, uint64_t _maxBytesPerSec)
+{
+    remote = _rfs;
+    maxConcurrent = _maxConcurrent > 0 ? _maxConcurrent : 1;
+    maxBytesPerSec = _maxBytesPerSec;
+}
+
+rfs::transferMngr::~transferMngr()
+{
+    for(transferItem *t : transfers)
+        delete t;
+}
+
+void rfs::transferMngr::addUpload(const std::string& _localPath, const std::string& _name, const std::string& _parent, const std::string& _fileID)
+{
+    transferItem *newItem = new transferItem;
+    newItem->type = TRANSFER_UPLOAD;
+    newItem->localPath = _localPath;
+    newItem->name = _name;
+    newItem->parent = _parent;
+    newItem->id = _fileID;
+    newItem->size = fs::fsize(_localPath);
+    transfers.push_back(newItem);
+}
+
+void rfs::transferMngr::addUpload(FILE *_f, const std::string& _name, const std::string& _parent, const std::string& _fileID)
+{
+    transferItem *newItem = new transferItem;
+    newItem->type = TRANSFER_UPLOAD;
+    newItem->src = _f;
+    newItem->name = _name;
+    newItem->parent = _parent;
+    newItem->id = _fileID;
+    fseeko(_f, 0, SEEK_END);
+    newItem->size = ftello(_f);
+    transfers.push_back(newItem);
+}
+
+void rfs::transferMngr::addDownload(const std::string& _fileID, const std::string& _name, const std::string& _localPath, uint64_t _size)
+{
+    transferItem *newItem = new transferItem;
+    newItem->type = TRANSFER_DOWNLOAD;
+    newItem->id = _fileID;
+    newItem->name = _name;
+    newItem->localPath = _localPath;
+    newItem->size = _size;
+    transfers.push_back(newItem);
+}
+
+CURL *rfs::transferMngr::start(CURLM *_multi, transferItem *_item)
+{
+    CURL *curl = curlFuncs::borrowHandle();
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, _item);
+
+    bool prepared = false;
+    if(_item->type == TRANSFER_UPLOAD)
+    {
+        _item->sendFrom = 0;
+        _item->sendTo = _item->size;
+        _item->response.clear();
+        _item->respHeaders.clear();
+        _item->f = _item->src ? _item->src : fopen(_item->localPath.c_str(), "rb");
+        prepared = _item->f && remote->prepareUpload(curl, _item);
+        if(prepared)
+        {
+            fseek(_item->f, _item->sendFrom, SEEK_SET);
+            _item->offset = _item->sendFrom;
+        }
+        curl_easy_setopt(curl, CURLOPT_READFUNCTION, transferRead);
+        curl_easy_setopt(curl, CURLOPT_READDATA, _item);
+        curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, (curl_off_t)(_item->sendTo - _item->sendFrom));
+        curl_easy_setopt(curl, CURLOPT_UPLOAD_BUFFERSIZE, UPLOAD_BUFFER_SIZE);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &_item->response);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlFuncs::writeHeaders);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &_item->respHeaders);
+    }
+    else
+    {
+        //Continue from a .part left by an earlier attempt
+        std::string partPath = _item->localPath + ".part";
+        _item->offset = fs::fileExists(partPath) ? fs::fsize(partPath) : 0;
+        if(_item->offset > _item->size)
+            _item->offset = 0;
+
+        _item->f = fopen(partPath.c_str(), _item->offset > 0 ? "ab" : "wb");
+        prepared = _item->f && remote->prepareDownload(curl, _item);
+        curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1);
+        curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, (curl_off_t)_item->offset);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, transferWrite);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, _item);
+    }
+
+    if(!prepared || curl_multi_add_handle(_multi, curl) != CURLM_OK)
+    {
+        fs::logWrite("transferMngr: Failed to start %s.\n", _item->name.c_str());
+        if(_item->f && _item->f != _item->src)
+            fclose(_item->f);
+        _item->f = NULL;
+        curl_slist_free_all(_item->headers);
+        _item->headers = NULL;
+        _item->finished = true;
+        curlFuncs::returnHandle(curl);
+        return NULL;
+    }
+    return curl;
+}
+
+bool rfs::transferMngr::finish(CURLM *_multi, CURL *_curl, CURLcode _res)
+{
+    transferItem *item = NULL;
+    curl_easy_getinfo(_curl, CURLINFO_PRIVATE, (char **)&item);
+
+    long respCode = 0;
+    curl_easy_getinfo(_curl, CURLINFO_RESPONSE_CODE, &respCode);
+
+    if(item->f != item->src)
+        fclose(item->f);
+    item->f = NULL;
+    item->success = _res == CURLE_OK && respCode < 400;
+    item->finished = true;
+    if(item->type == TRANSFER_DOWNLOAD)
+    {
+        std::string partPath = item->localPath + ".part";
+        //416 here means the .part was already complete
+        if(respCode == 416 && fs::fsize(partPath) == item->size)
+            item->success = true;
+        else if(item->success && fs::fsize(partPath) != item->size)
+            item->success = false;
+
+        //Same check downloadFile does. A bad .part is thrown out so the next attempt doesn't continue it
+        if(item->success && !item->checksum.empty() && item->checksum != fileSha256(partPath))
+        {
+            fs::logWrite("transferMngr: Checksum mismatch for %s.\n", item->name.c_str());
+            fs::delfile(partPath);
+            item->success = false;
+        }
+
+        if(item->success)
+            item->success = finishDownloadFile(partPath, item->localPath, isRemoteGzip(item->name));
+        else if(_res == CURLE_RANGE_ERROR)
+            fs::delfile(partPath);
+    }
+
+    item->again = false;
+    remote->finishTransfer(_curl, item, item->success);
+    if(item->again)
+        item->finished = false;
+    else if(!item->success)
+        fs::logWrite("transferMngr: %s failed. CURL: %i HTTP: %li\n", item->name.c_str(), _res, respCode);
+
+    curl_multi_remove_handle(_multi, _curl);
+    curl_slist_free_all(item->headers);
+    item->headers = NULL;
+    curlFuncs::returnHandle(_curl);
+    return item->again;
+}
+
+void rfs::transferMngr::setSpeedLimits(const std::vector<CURL *>& _active)
+{
+    if(maxBytesPerSec == 0 || _active.empty())
+        return;
+
+    curl_off_t perHandle = maxBytesPerSec / _active.size();
+    if(perHandle == 0)
+        perHandle = 1;
+
+    //Curl checks these as it goes, so handles already running pick the new limit up
+    for(CURL *c : _active)
+    {
+        transferItem *item = NULL;
+        curl_easy_getinfo(c, CURLINFO_PRIVATE, (char **)&item);
+        curl_easy_setopt(c, item->type == TRANSFER_UPLOAD ? CURLOPT_MAX_SEND_SPEED_LARGE : CURLOPT_MAX_RECV_SPEED_LARGE, perHandle);
+    }
+}
+
+void rfs::transferMngr::updateStatus(threadInfo *t)
+{
+    std::string status;
+    unsigned done = 0;
+    for(transferItem *item : transfers)
+    {
+        if(item->finished)
+        {
+            ++done;
+            continue;
+        }
+
+        if(item->f)
+        {
+            char line[256];
+            snprintf(line, 256, "#%s#  %.2fMB / %.2fMB\n", item->name.c_str(), (float)item->offset / 1024.0f / 1024.0f, (float)item->size / 1024.0f / 1024.0f);
+            status += line;
+        }
+    }
+    //Average since run() started
+    double seconds = (double)(armGetSystemTick() - startTick) / armGetSystemTickFreq();
+    double kbps = seconds > 0 ? (double)getTotalTransferred() / 1024.0 / seconds : 0;
+    if(statusHeader.empty())
+        t->status->setStatus("%u / %u  %.0f KB/s\n%s", done, (unsigned)transfers.size(), kbps, status.c_str());
+    else
+        t->status->setStatus("%s\n%u / %u  %.0f KB/s\n%s", statusHeader.c_str(), done, (unsigned)transfers.size(), kbps, status.c_str());
+
+    if(t->argPtr)
+    {
+        fs::copyArgs *c = (fs::copyArgs *)t->argPtr;
+        c->argLock();
+        c->offset = getTotalTransferred();
+        c->argUnlock();
+    }
+}
+
+void rfs::transferMngr::run(threadInfo *t)
+{
+    if(t && t->argPtr)
+    {
+        fs::copyArgs *c = (fs::copyArgs *)t->argPtr;
+        c->prog->setMax(getTotalSize());
+        c->prog->update(0);
+    }
+
+    startTick = armGetSystemTick();
+    CURLM *multi = curl_multi_init();
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)maxConcurrent);
+
+    //Looked up here instead of when each one finishes so a request for it doesn't hold up the others
+    for(transferItem *item : transfers)
+    {
+        if(item->type == TRANSFER_DOWNLOAD && item->checksum.empty())
+            item->checksum = remote->getChecksum(item->id);
+    }
+
+    unsigned next = 0;
+    std::vector<CURL *> active;
+    //Transfers that need another request, like the next piece of an upload or a retry
+    std::vector<transferItem *> again;
+    while(!canceled && (next < transfers.size() || !active.empty() || !again.empty()))
+    {
+        size_t activeBefore = active.size();
+        uint64_t now = armGetSystemTick();
+        for(unsigned i = 0; i < again.size() && active.size() < maxConcurrent; )
+        {
+            if(again[i]->retryAt > now)
+            {
+                ++i;
+                continue;
+            }
+
+            CURL *started = start(multi, again[i]);
+            if(started)
+                active.push_back(started);
+            again.erase(again.begin() + i);
+        }
+
+        while(active.size() < maxConcurrent && next < transfers.size())
+        {
+            CURL *started = start(multi, transfers[next++]);
+            if(started)
+                active.push_back(started);
+        }
+
+        if(active.size() != activeBefore)
+            setSpeedLimits(active);
+        activeBefore = active.size();
+
+        int running = 0;
+        curl_multi_perform(multi, &running);
+
+        int msgsLeft = 0;
+        CURLMsg *msg = NULL;
+        while((msg = curl_multi_info_read(multi, &msgsLeft)))
+        {
+            if(msg->msg == CURLMSG_DONE)
+            {
+                CURL *done = msg->easy_handle;
+                CURLcode res = msg->data.result;
+                transferItem *item = NULL;
+                curl_easy_getinfo(done, CURLINFO_PRIVATE, (char **)&item);
+                if(finish(multi, done, res))
+                    again.push_back(item);
+                active.erase(std::find(active.begin(), active.end(), done));
+            }
+        }
+
+        if(active.size() != activeBefore)
+            setSpeedLimits(active);
+
+        if(t)
+            updateStatus(t);
+
+        if(running > 0)
+            curl_multi_poll(multi, NULL, 0, 100, NULL);
+        else if(active.empty() && !again.empty())
+            svcSleepThread(100000000);
+    }
+
+    //Anything still running after a cancel
+    for(CURL *c : active)
+        finish(multi, c, CURLE_ABORTED_BY_CALLBACK);
+
+    curl_multi_cleanup(multi);
+}
+
+unsigned rfs::transferMngr::getFailedCount()
+{
+    unsigned ret = 0;
+    for(transferItem *item : transfers)
+    {
+        if(!item->success)
+            ++ret;
+    }
+    return ret;
+}
+
+uint64_t rfs::transferMngr::getTotalSize()
+{
+    uint64_t ret = 0;
+    for(transferItem *item : transfers)
+        ret += item->size;
+
+    return ret;
+}
+
+uint64_t rfs::transferMngr::getTotalTransferred()
+{
+    uint64_t ret = 0;
+    for(transferItem *item : transfers)
+        ret += item->finished && item->success ? item->size : item->offset;
 
-    return sz * cnt;
+    return ret;
 }
@@ -179,6 +179,16 @@ threadInfo *ui::newThread(ThreadFunc func, void *args, funcPtr _drawFunc)
     return threadMngr->newThread(func, args, _drawFunc);
 }
 
+threadInfo *ui::newBackgroundThread(ThreadFunc func, void *args)
+{
+    return threadMngr->newBackgroundThread(func, args);
+}
+
+bool ui::foregroundIdle()
+{
+    return threadMngr->empty();
+}
+
 void ui::showLoadScreen()
 {
     SDL_Texture *icon = gfx::texMgr->textureLoadFromFile("romfs:/icon.png");
@@ -223,6 +233,7 @@ void ui::drawUI()
     for(slideOutPanel *s : panels)
         s->draw(&ui::slidePanelColor);
 
+    threadMngr->drawBackground();
     threadMngr->draw();
 
     popMessages->draw();
@@ -268,7 +279,9 @@ bool ui::runApp()
     else
         threadMngr->update();
 
+    threadMngr->updateBackground();
     popMessages->update();
+    data::update();
 
     drawUI();
     if(debugDisp)
@@ -1,4 +1,5 @@
 #include <switch.h>
+#include <atomic>
 
 #include "ui.h"
 #include "fs.h"
@@ -14,11 +15,58 @@ static Mutex fldLock = 0;
 static std::string driveParent;
 static std::vector<rfs::RfsItem> driveFldList;
 
+//Remote listing runs in the background so the panel opens right away. Setting cancel stops it and throws away what it got.
+typedef struct
+{
+    std::string safeTitle;
+    std::atomic<bool> cancel;
+} fldRemoteLoad;
+static fldRemoteLoad *fldLoading = NULL;
+//What the load got. The menu isn't rebuilt from background threads while the UI is running it, so fldUpdate picks these up.
+static bool fldLoadDone = false;
+static std::string fldLoadParent;
+static std::vector<rfs::RfsItem> fldLoadList;
+
+//Has to be called with fldLock held
+static void fldCancelRemoteLoad()
+{
+    if(fldLoading)
+    {
+        fldLoading->cancel = true;
+        fldLoading = NULL;
+    }
+    fldLoadDone = false;
+    fldLoadParent.clear();
+    fldLoadList.clear();
+}
+
+//Remote functions need driveParent and driveFldList
+static bool fldRemoteReady()
+{
+    if(!fs::rfs)
+    {
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteNotActive", 0));
+        return false;
+    }
+
+    mutexLock(&fldLock);
+    bool loading = fldLoading != NULL || fldLoadDone;
+    mutexUnlock(&fldLock);
+
+    if(loading)
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteLoading", 0));
+
+    return !loading;
+}
+
 static void fldMenuCallback(void *a)
 {
     switch(ui::padKeysDown())
     {
         case HidNpadButton_B:
+            mutexLock(&fldLock);
+            fldCancelRemoteLoad();
+            mutexUnlock(&fldLock);
             fs::unmountSave();
             fs::freePathFilters();
             fldMenu->setActive(false);
@@ -48,6 +96,21 @@ static void fldFuncCancel(void *a)
     delete del;
 }
 
+//Remote functions get their own copy of the item since driveFldList is replaced whenever the list is refreshed
+static void fldFuncRemoteCancel(void *a)
+{
+    rfs::RfsItem *del = (rfs::RfsItem *)a;
+    delete del;
+}
+
+static rfs::RfsItem *fldCopyRemoteItem(void *a)
+{
+    mutexLock(&fldLock);
+    rfs::RfsItem *ret = new rfs::RfsItem(*(rfs::RfsItem *)a);
+    mutexUnlock(&fldLock);
+    return ret;
+}
+
 static void fldFuncOverwrite(void *a)
 {
     fs::dirItem *in = (fs::dirItem *)a;
@@ -98,7 +161,7 @@ static void fldFuncUpload_t(void *a)
     {
         t->status->setStatus(ui::getUICString("threadStatusCompressingSaveForUpload", 0), di->getItm().c_str());
         filename = di->getItm() + ".zip";
-        tmpZip = util::generatePathByTID(utinfo->tid) + di->getItm() + ".zip";
+        tmpZip = fs::remoteTmpPath(".zip");
         std::string fldPath = util::generatePathByTID(utinfo->tid) + di->getItm() + "/";
 
         int zipTrim = util::getTotalPlacesInPath(fs::getWorkDir()) + 2;//Trim path down to save root
@@ -113,34 +176,47 @@ static void fldFuncUpload_t(void *a)
         path = util::generatePathByTID(utinfo->tid) + di->getItm();
     }
 
-    //Change thread stuff so upload status can be shown
-    t->status->setStatus(ui::getUICString("threadStatusUploadingFile", 0), di->getItm().c_str());
-    fs::copyArgs *cpyArgs = fs::copyArgsCreate("", "", "", NULL, NULL, false, false, 0);
-    cpyArgs->prog->setMax(fs::fsize(path));
-    cpyArgs->prog->update(0);
-    t->argPtr = cpyArgs;
-    t->drawFunc = fs::fileDrawFunc;
-
-    //curlDlArgs
-    curlFuncs::curlUpArgs upload;
-    upload.f = fopen(path.c_str(), "rb");
-    upload.o = &cpyArgs->offset;
-
-    if(fs::rfs->fileExists(filename, driveParent))
+    if(cfg::config["remoteChunks"])
     {
-        std::string id = fs::rfs->getFileID(filename, driveParent);
-        fs::rfs->updateFile(id, &upload);
+        //dirItem isn't needed anymore and chunkUpload sets up its own progress
+        t->argPtr = NULL;
+        if(!fs::chunkUpload(path, filename, driveParent, t))
+            ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteUploadFailed", 0), filename.c_str());
     }
     else
-        fs::rfs->uploadFile(filename, driveParent, &upload);
+    {
+        std::string sendPath = fs::remoteCompressUpload(path, filename, t);
+        if(sendPath != path)
+        {
+            if(!tmpZip.empty())
+                fs::delfile(tmpZip);
+            path = tmpZip = sendPath;
+        }
 
-    fclose(upload.f);
+        std::string id = fs::rfs->fileExists(filename, driveParent) ? fs::rfs->getFileID(filename, driveParent) : "";
+        //Don't send it again if the remote copy is the same
+        if(!id.empty() && fs::rfs->remoteMatches(path, id))
+            ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteUpToDate", 0), filename.c_str());
+        else
+        {
+            //Change thread stuff so upload status can be shown
+            fs::copyArgs *cpyArgs = fs::copyArgsCreate("", "", "", NULL, NULL, false, false, 0);
+            t->argPtr = cpyArgs;
+            t->drawFunc = fs::fileDrawFunc;
+
+            rfs::transferMngr upload(fs::rfs, 1, (uint64_t)cfg::remoteMaxKBps * 1024);
+            upload.addUpload(path, filename, driveParent, id);
+            upload.run(t);
+            if(upload.getFailedCount() > 0)
+                ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteUploadFailed", 0), filename.c_str());
+
+            fs::copyArgsDestroy(cpyArgs);
+            t->drawFunc = NULL;
+        }
+    }
 
     if(!tmpZip.empty())
         fs::delfile(tmpZip);
-    
-    fs::copyArgsDestroy(cpyArgs);
-    t->drawFunc = NULL;
 
     if(cfg::config["ovrClk"])
         util::sysNormal();
@@ -152,10 +228,19 @@ static void fldFuncUpload_t(void *a)
 
 static void fldFuncUpload(void *a)
 {
-    if(fs::rfs)
+    if(fldRemoteReady())
         ui::newThread(fldFuncUpload_t, a, NULL);
-    else
-        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteNotActive", 0));
+}
+
+//Chunk manifests and gzipped uploads are saved under the name of the backup they hold
+static std::string fldGetLocalName(const rfs::RfsItem *_item)
+{
+    if(fs::isChunkManifest(_item->name))
+        return _item->name.substr(0, _item->name.length() - std::string(CHUNK_MANIFEST_EXT).length());
+    else if(rfs::isRemoteGzip(_item->name))
+        return _item->name.substr(0, _item->name.length() - std::string(REMOTE_GZIP_EXT).length());
+
+    return _item->name;
 }
 
 static void fldFuncDownload_t(void *a)
@@ -163,12 +248,13 @@ static void fldFuncDownload_t(void *a)
     threadInfo *t = (threadInfo *)a;
     rfs::RfsItem *in = (rfs::RfsItem *)t->argPtr;
     data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
-    std::string targetPath = util::generatePathByTID(utinfo->tid) + in->name;
+    std::string targetPath = util::generatePathByTID(utinfo->tid) + fldGetLocalName(in);
     t->status->setStatus(ui::getUICString("threadStatusDownloadingFile", 0), in->name.c_str());
     
     if(cfg::config["ovrClk"])
         util::sysBoost();
 
+    fs::remoteQueueRelease(targetPath);
     if(fs::fileExists(targetPath))
         fs::delfile(targetPath);
 
@@ -184,13 +270,16 @@ static void fldFuncDownload_t(void *a)
     dlFile.path = targetPath;
     dlFile.size = in->size;
     dlFile.o = &cpy->offset;
+    dlFile.gunzip = rfs::isRemoteGzip(in->name);
     
-    fs::rfs->downloadFile(in->id, &dlFile);
-
-    //fclose(dlFile.f);
+    bool downloaded = fs::isChunkManifest(in->name) ? fs::chunkDownload(*in, targetPath, t) : fs::rfs->downloadFile(in->id, &dlFile);
+    if(!downloaded)
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteDownloadFailed", 0), in->name.c_str());
 
     fs::copyArgsDestroy(cpy);
+    t->argPtr = NULL;
     t->drawFunc = NULL;
+    delete in;
 
     if(cfg::config["ovrClk"])
         util::sysNormal();
@@ -202,16 +291,16 @@ static void fldFuncDownload_t(void *a)
 
 static void fldFuncDownload(void *a)
 {
-    rfs::RfsItem *in = (rfs::RfsItem *)a;
+    rfs::RfsItem *in = fldCopyRemoteItem(a);
     data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
-    std::string testPath = util::generatePathByTID(utinfo->tid) + in->name;
+    std::string testPath = util::generatePathByTID(utinfo->tid) + fldGetLocalName(in);
     if(fs::fileExists(testPath))
     {
-        ui::confirmArgs *conf = ui::confirmArgsCreate(cfg::config["holdOver"], fldFuncDownload_t, NULL, a, ui::getUICString("confirmDriveOverwrite", 0));
+        ui::confirmArgs *conf = ui::confirmArgsCreate(cfg::config["holdOver"], fldFuncDownload_t, fldFuncRemoteCancel, in, ui::getUICString("confirmDriveOverwrite", 0));
         ui::confirm(conf);
     }
     else
-        ui::newThread(fldFuncDownload_t, a, NULL);
+        ui::newThread(fldFuncDownload_t, in, NULL);
 
 }
 
@@ -221,14 +310,16 @@ static void fldFuncDriveDelete_t(void *a)
     rfs::RfsItem *gdi = (rfs::RfsItem *)t->argPtr;
     t->status->setStatus(ui::getUICString("threadStatusDeletingFile", 0));
     fs::rfs->deleteFile(gdi->id);
+    delete gdi;
+    t->argPtr = NULL;
     ui::fldRefreshMenu();
     t->finished = true;    
 }
 
 static void fldFuncDriveDelete(void *a)
 {
-    rfs::RfsItem *in = (rfs::RfsItem *)a;
-    ui::confirmArgs *conf = ui::confirmArgsCreate(cfg::config["holdDel"], fldFuncDriveDelete_t, NULL, a, ui::getUICString("confirmDelete", 0), in->name.c_str());
+    rfs::RfsItem *in = fldCopyRemoteItem(a);
+    ui::confirmArgs *conf = ui::confirmArgsCreate(cfg::config["holdDel"], fldFuncDriveDelete_t, fldFuncRemoteCancel, in, ui::getUICString("confirmDelete", 0), in->name.c_str());
     ui::confirm(conf);
 }
 
@@ -248,25 +339,133 @@ static void fldFuncDriveRestore_t(void *a)
     dlFile.path = "sdmc:/tmp.zip";
     dlFile.size = gdi->size;
     dlFile.o = &cpy->offset;
+    dlFile.gunzip = rfs::isRemoteGzip(gdi->name);
 
-    fs::rfs->downloadFile(gdi->id, &dlFile);
-
-    unzFile tmp = unzOpen64("sdmc:/tmp.zip");
-    fs::copyZipToDir(tmp, "sv:/", "sv", t);
-    unzClose(tmp);
-    fs::delfile("sdmc:/tmp.zip");
+    //Don't touch the save if the download didn't make it
+    bool downloaded = fs::isChunkManifest(gdi->name) ? fs::chunkDownload(*gdi, dlFile.path, t) : fs::rfs->downloadFile(gdi->id, &dlFile);
+    if(downloaded)
+    {
+        unzFile tmp = unzOpen64("sdmc:/tmp.zip");
+        fs::copyZipToDir(tmp, "sv:/", "sv", t);
+        unzClose(tmp);
+        fs::delfile("sdmc:/tmp.zip");
+    }
+    else
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteDownloadFailed", 0), gdi->name.c_str());
 
     fs::copyArgsDestroy(cpy);
     t->argPtr = NULL;
     t->drawFunc = NULL;
+    delete gdi;
 
     t->finished = true;
 }
 
 static void fldFuncDriveRestore(void *a)
 {
-    rfs::RfsItem *in = (rfs::RfsItem *)a;
-    ui::confirmArgs *conf = ui::confirmArgsCreate(cfg::config["holdOver"], fldFuncDriveRestore_t, NULL, a, ui::getUICString("confirmRestore", 0), in->name.c_str());
+    rfs::RfsItem *in = fldCopyRemoteItem(a);
+    ui::confirmArgs *conf = ui::confirmArgsCreate(cfg::config["holdOver"], fldFuncDriveRestore_t, fldFuncRemoteCancel, in, ui::getUICString("confirmRestore", 0), in->name.c_str());
+    ui::confirm(conf);
+}
+
+static void fldFuncUploadAll_t(void *a)
+{
+    threadInfo *t = (threadInfo *)a;
+    fsSetPriority(FsPriority_Realtime);
+    data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
+    std::string titlePath = util::generatePathByTID(utinfo->tid);
+    std::vector<std::string> tmpZips;
+
+    if(cfg::config["ovrClk"])
+        util::sysBoost();
+
+    rfs::transferMngr transfers(fs::rfs, cfg::remoteMaxTransfers, (uint64_t)cfg::remoteMaxKBps * 1024);
+    fs::remoteQueueUploads(transfers, titlePath, driveParent, tmpZips, t);
+
+    fs::copyArgs *cpyArgs = fs::copyArgsCreate("", "", "", NULL, NULL, false, false, 0);
+    t->argPtr = cpyArgs;
+    t->drawFunc = fs::fileDrawFunc;
+    transfers.run(t);
+    t->drawFunc = NULL;
+    fs::copyArgsDestroy(cpyArgs);
+
+    for(const std::string& z : tmpZips)
+        fs::delfile(z);
+
+    if(cfg::config["ovrClk"])
+        util::sysNormal();
+
+    if(transfers.getFailedCount() > 0)
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteTransfersFailed", 0), transfers.getFailedCount(), transfers.getCount());
+
+    ui::fldRefreshMenu();
+    t->finished = true;
+}
+
+static void fldFuncUploadAll(void *a)
+{
+    if(fldRemoteReady())
+        ui::newThread(fldFuncUploadAll_t, NULL, NULL);
+}
+
+static void fldFuncDownloadAll_t(void *a)
+{
+    threadInfo *t = (threadInfo *)a;
+    data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
+    std::string titlePath = util::generatePathByTID(utinfo->tid);
+
+    if(cfg::config["ovrClk"])
+        util::sysBoost();
+
+    //Work off a copy, the list can be replaced by a refresh while this runs
+    mutexLock(&fldLock);
+    std::vector<rfs::RfsItem> remoteList = driveFldList;
+    mutexUnlock(&fldLock);
+
+    rfs::transferMngr transfers(fs::rfs, cfg::remoteMaxTransfers, (uint64_t)cfg::remoteMaxKBps * 1024);
+    std::vector<rfs::RfsItem *> manifests;
+    for(rfs::RfsItem& item : remoteList)
+    {
+        if(item.isDir)
+            continue;
+        else if(fs::isChunkManifest(item.name))
+            manifests.push_back(&item);
+        else
+            transfers.addDownload(item.id, item.name, titlePath + fldGetLocalName(&item), item.size);
+    }
+
+    fs::copyArgs *cpyArgs = fs::copyArgsCreate("", "", "", NULL, NULL, false, false, 0);
+    t->argPtr = cpyArgs;
+    t->drawFunc = fs::fileDrawFunc;
+    transfers.run(t);
+    t->drawFunc = NULL;
+    t->argPtr = NULL;
+    fs::copyArgsDestroy(cpyArgs);
+
+    //Chunked backups each run their own set of transfers
+    unsigned failed = transfers.getFailedCount();
+    for(rfs::RfsItem *m : manifests)
+    {
+        if(!fs::chunkDownload(*m, titlePath + fldGetLocalName(m), t))
+            ++failed;
+    }
+
+    if(cfg::config["ovrClk"])
+        util::sysNormal();
+
+    if(failed > 0)
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteTransfersFailed", 0), failed, transfers.getCount() + (unsigned)manifests.size());
+
+    ui::fldRefreshMenu();
+    t->finished = true;
+}
+
+static void fldFuncDownloadAll(void *a)
+{
+    if(!fldRemoteReady())
+        return;
+
+    ui::confirmArgs *conf = ui::confirmArgsCreate(cfg::config["holdOver"], fldFuncDownloadAll_t, NULL, NULL, ui::getUICString("confirmDriveOverwriteAll", 0));
     ui::confirm(conf);
 }
 
@@ -292,37 +491,25 @@ void ui::fldExit()
     delete fldList;
 }
 
-void ui::fldUpdate()
+//Has to be called with fldLock held. Keeps the cursor on the same entry when the remote list changes size.
+static void fldBuildMenu()
 {
-    fldMenu->update();
-}
-
-void ui::fldPopulateMenu()
-{
-    mutexLock(&fldLock);
+    int sel = fldMenu->getSelected(), oldRemoteCount = fldMenu->getCount() - 1 - (int)fldList->getCount();
 
     fldMenu->reset();
-
-    data::userTitleInfo *d = data::getCurrentUserTitleInfo();
-    data::titleInfo *t = data::getTitleInfoByTID(d->tid);
-    util::createTitleDirectoryByTID(d->tid);
-    std::string targetDir = util::generatePathByTID(d->tid);
-
-    fldList->reassign(targetDir);
-    fs::loadPathFilters(d->tid);
-
-    fldMenu->addOpt(NULL, ui::getUICString("folderMenuNew", 0));
+    fldMenu->addOpt(NULL, ui::getUIString("folderMenuNew", 0));
     fldMenu->optAddButtonEvent(0, HidNpadButton_A, fs::createNewBackup, NULL);
+    fldMenu->optAddButtonEvent(0, HidNpadButton_ZR, fldFuncUploadAll, NULL);
+    fldMenu->optAddButtonEvent(0, HidNpadButton_ZL, fldFuncDownloadAll, NULL);
 
     unsigned fldInd = 1;
-    if(fs::rfs)
+    if(fs::rfs && (fldLoading || fldLoadDone))
+    {
+        fldMenu->addOpt(NULL, ui::getUIString("folderMenuRemoteLoading", 0));
+        fldInd++;
+    }
+    else if(fs::rfs)
     {
-        if(!fs::rfs->dirExists(t->safeTitle, fs::rfsRootID))
-            fs::rfs->createDir(t->safeTitle, fs::rfsRootID);
-
-        driveParent = fs::rfs->getDirID(t->safeTitle, fs::rfsRootID);
-        driveFldList = fs::rfs->getListWithParent(driveParent);
-
         for(unsigned i = 0; i < driveFldList.size(); i++, fldInd++)
         {
             fldMenu->addOpt(NULL, "[R] " + driveFldList[i].name);
@@ -332,6 +519,7 @@ void ui::fldPopulateMenu()
             fldMenu->optAddButtonEvent(fldInd, HidNpadButton_Y, fldFuncDriveRestore, &driveFldList[i]);
         }
     }
+    int remoteCount = fldInd - 1;
 
     for(unsigned i = 0; i < fldList->getCount(); i++, fldInd++)
     {
@@ -343,49 +531,128 @@ void ui::fldPopulateMenu()
         fldMenu->optAddButtonEvent(fldInd, HidNpadButton_Y, fldFuncRestore, di);
         fldMenu->optAddButtonEvent(fldInd, HidNpadButton_ZR, fldFuncUpload, di);
     }
-    fldMenu->setActive(true);
-    ui::fldPanel->openPanel();
 
+    if(sel > oldRemoteCount && oldRemoteCount >= 0)
+        sel += remoteCount - oldRemoteCount;
+
+    if(sel >= fldMenu->getCount())
+        sel = fldMenu->getCount() - 1;
+
+    fldMenu->setSelected(sel > 0 ? sel : 0);
+}
+
+void ui::fldUpdate()
+{
+    //Remote listing finished in the background. Only this thread changes the menu, so it's picked up here.
+    mutexLock(&fldLock);
+    if(fldLoadDone)
+    {
+        fldLoadDone = false;
+        driveParent = fldLoadParent;
+        driveFldList.swap(fldLoadList);
+        fldLoadList.clear();
+        fldBuildMenu();
+    }
     mutexUnlock(&fldLock);
+
+    fldMenu->update();
 }
 
-void ui::fldRefreshMenu()
+static void fldLoadRemote_t(void *a)
+{
+    threadInfo *t = (threadInfo *)a;
+    fldRemoteLoad *load = (fldRemoteLoad *)t->argPtr;
+    t->status->setStatus(ui::getUICString("threadStatusLoadingRemote", 0));
+
+    //Closing the panel aborts whatever request is running instead of waiting on the network
+    curlFuncs::setThreadCancelFlag(&load->cancel);
+
+    std::string parent;
+    std::vector<rfs::RfsItem> list;
+    if(!load->cancel && !fs::rfs->dirExists(load->safeTitle, fs::rfsRootID))
+        fs::rfs->createDir(load->safeTitle, fs::rfsRootID);
+
+    if(!load->cancel)
+        parent = fs::rfs->getDirID(load->safeTitle, fs::rfsRootID);
+
+    if(!load->cancel)
+        list = fs::rfs->getListWithParent(parent);
+
+    curlFuncs::setThreadCancelFlag(NULL);
+
+    mutexLock(&fldLock);
+    if(!load->cancel)
+    {
+        fldLoading = NULL;
+        fldLoadParent = parent;
+        fldLoadList.swap(list);
+        fldLoadDone = true;
+    }
+    mutexUnlock(&fldLock);
+
+    delete load;
+    t->finished = true;
+}
+
+void ui::fldPopulateMenu()
 {
     mutexLock(&fldLock);
 
+    //Anything still loading for the last title is stale now
+    fldCancelRemoteLoad();
     fldMenu->reset();
-    data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
-    std::string targetDir = util::generatePathByTID(utinfo->tid);
+
+    data::userTitleInfo *d = data::getCurrentUserTitleInfo();
+    data::titleInfo *t = data::getTitleInfoByTID(d->tid);
+    util::createTitleDirectoryByTID(d->tid);
+    std::string targetDir = util::generatePathByTID(d->tid);
 
     fldList->reassign(targetDir);
-    fldMenu->addOpt(NULL, ui::getUIString("folderMenuNew", 0));
-    fldMenu->optAddButtonEvent(0, HidNpadButton_A, fs::createNewBackup, NULL);
+    fs::loadPathFilters(d->tid);
 
-    unsigned fldInd = 1;
+    driveParent.clear();
+    driveFldList.clear();
     if(fs::rfs)
     {
-        driveFldList = fs::rfs->getListWithParent(driveParent);
+        fldRemoteLoad *load = new fldRemoteLoad;
+        load->cancel = false;
+        load->safeTitle = t->safeTitle;
+        if(ui::newBackgroundThread(fldLoadRemote_t, load))
+            fldLoading = load;
+        else
+            delete load;
+    }
 
-        for(unsigned i = 0; i < driveFldList.size(); i++, fldInd++)
-        {
-            fldMenu->addOpt(NULL, "[R] " + driveFldList[i].name);
+    fldBuildMenu();
+    fldMenu->setActive(true);
+    ui::fldPanel->openPanel();
 
-            fldMenu->optAddButtonEvent(fldInd, HidNpadButton_A, fldFuncDownload, &driveFldList[i]);
-            fldMenu->optAddButtonEvent(fldInd, HidNpadButton_X, fldFuncDriveDelete, &driveFldList[i]);
-            fldMenu->optAddButtonEvent(fldInd, HidNpadButton_Y, fldFuncDriveRestore, &driveFldList[i]);
-        }
-    }
+    mutexUnlock(&fldLock);
+}
 
-    for(unsigned i = 0; i < fldList->getCount(); i++, fldInd++)
-    {
-        fs::dirItem *di = fldList->getDirItemAt(i);
-        fldMenu->addOpt(NULL, di->getItm());
+void ui::fldRefreshMenu()
+{
+    //Network happens before locking so drawing isn't held up
+    std::vector<rfs::RfsItem> list;
+    mutexLock(&fldLock);
+    bool loadRemote = fs::rfs && !fldLoading && !fldLoadDone && !driveParent.empty();
+    std::string parent = driveParent;
+    mutexUnlock(&fldLock);
 
-        fldMenu->optAddButtonEvent(fldInd, HidNpadButton_A, fldFuncOverwrite, di);
-        fldMenu->optAddButtonEvent(fldInd, HidNpadButton_X, fldFuncDelete, di);
-        fldMenu->optAddButtonEvent(fldInd, HidNpadButton_Y, fldFuncRestore, di);
-        fldMenu->optAddButtonEvent(fldInd, HidNpadButton_ZR, fldFuncUpload, di);
-    }
+    if(loadRemote)
+        list = fs::rfs->getListWithParent(parent);
+
+    mutexLock(&fldLock);
+
+    data::userTitleInfo *utinfo = data::getCurrentUserTitleInfo();
+    std::string targetDir = util::generatePathByTID(utinfo->tid);
+    fldList->reassign(targetDir);
+
+    //Title could have changed while listing
+    if(loadRemote && parent == driveParent)
+        driveFldList = list;
+
+    fldBuildMenu();
 
     mutexUnlock(&fldLock);
-}
\ No newline at end of file
+}
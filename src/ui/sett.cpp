@@ -10,6 +10,8 @@
 ui::menu *ui::settMenu;
 static ui::slideOutPanel *blEditPanel;
 static ui::menu *blEditMenu;
+//Blacklist is a set, so the menu's order is kept here
+static std::vector<uint64_t> blEditTIDs;
 
 //This is the name of strings used here
 static const char *settMenuStr = "settingsMenu";
@@ -58,7 +60,9 @@ static void settMenuDeleteAllBackups_t(void *a)
     {
         if(jksvDir->isDir(i) && jksvDir->getItem(i) != "svi")
         {
-            std::string delTarget = fs::getWorkDir() + jksvDir->getItem(i) + "/";
+            std::string delTarget = fs::getWorkDir() + jksvDir->getItem(i);
+            fs::remoteQueueRelease(delTarget);
+            delTarget += "/";
             fs::delDir(delTarget);
         }
     }
@@ -93,7 +97,7 @@ static void blEditMenuCallback(void *a)
 
 static void blEditMenuRemoveTitle(void *a)
 {
-    uint64_t remTID = cfg::blacklist[blEditMenu->getSelected()];
+    uint64_t remTID = blEditTIDs[blEditMenu->getSelected()];
     cfg::removeTitleFromBlacklist(remTID);
     if(cfg::blacklist.size() > 0)
         blEditMenuPopulate();
@@ -108,9 +112,10 @@ static void blEditMenuRemoveTitle(void *a)
 static void blEditMenuPopulate()
 {
     blEditMenu->reset();
-    for(unsigned i = 0; i < cfg::blacklist.size(); i++)
+    blEditTIDs.assign(cfg::blacklist.begin(), cfg::blacklist.end());
+    for(unsigned i = 0; i < blEditTIDs.size(); i++)
     {
-        blEditMenu->addOpt(NULL, data::getTitleNameByTID(cfg::blacklist[i]));
+        blEditMenu->addOpt(NULL, data::getTitleNameByTID(blEditTIDs[i]));
         blEditMenu->optAddButtonEvent(i, HidNpadButton_A, blEditMenuRemoveTitle, NULL);
     }
 }
@@ -121,8 +126,7 @@ static void toggleOpt(void *a)
     switch(ui::settMenu->getSelected())
     {
         case 0:
-            fs::delDir(fs::getWorkDir() + "_TRASH_/");
-            mkdir(std::string(fs::getWorkDir() + "_TRASH_").c_str(), 777);
+            fs::trashEmpty();
             ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popTrashEmptied", 0));
             break;
 
@@ -218,7 +222,7 @@ static void toggleOpt(void *a)
         case 19:
             if(++cfg::sortType > 2)
                 cfg::sortType = 0;
-            data::loadUsersTitles(false);
+            data::sortUserTitles();
             ui::ttlRefresh();
             break;
 
@@ -227,6 +231,14 @@ static void toggleOpt(void *a)
             if(ui::animScale > 8)
                 ui::animScale = 1;
             break;
+
+        case 21:
+            toggleBool(cfg::config["autoUpload"]);
+            break;
+
+        case 22:
+            fs::chunkCollect();
+            break;
     }
     cfg::saveConfig();
 }
@@ -252,6 +264,7 @@ static void updateMenuText()
     char tmp[16];
     sprintf(tmp, "%.1f", ui::animScale);
     ui::settMenu->editOpt(20, NULL, ui::getUIString(settMenuStr, 20) + std::string(tmp));
+    ui::settMenu->editOpt(21, NULL, ui::getUIString(settMenuStr, 21) + getBoolText(cfg::config["autoUpload"]));
 }
 
 void ui::settInit()
@@ -268,7 +281,7 @@ void ui::settInit()
 
     optHelpX = 1220 - gfx::getTextWidth(ui::getUICString("helpSettings", 0), 18);
 
-    for(unsigned i = 0; i < 21; i++)
+    for(unsigned i = 0; i < 23; i++)
     {
         ui::settMenu->addOpt(NULL, ui::getUIString("settingsMenu", i));
         ui::settMenu->optAddButtonEvent(i, HidNpadButton_A, toggleOpt, NULL);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <switch.h>
 #include <vector>
 
@@ -10,6 +11,9 @@
 static const SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
 static const SDL_Color darkenBack = {0x00, 0x00, 0x00, 0xBB};
 
+//Lower than everything else so background work never gets in the way of the UI or foreground threads
+static const int bgThreadPrio = 0x3B;
+
 ui::threadProcMngr::~threadProcMngr()
 {
     for(threadInfo *t : threads)
@@ -19,6 +23,14 @@ ui::threadProcMngr::~threadProcMngr()
         delete t->status;
         delete t;
     }
+
+    for(threadInfo *t : bgThreads)
+    {
+        threadWaitForExit(&t->thrd);
+        threadClose(&t->thrd);
+        delete t->status;
+        delete t;
+    }
 }
 
 threadInfo *ui::threadProcMngr::newThread(ThreadFunc func, void *args, funcPtr _drawfunc)
@@ -37,6 +49,48 @@ threadInfo *ui::threadProcMngr::newThread(ThreadFunc func, void *args, funcPtr _
     return threads[threads.size() - 1];
 }
 
+bool ui::threadProcMngr::empty()
+{
+    mutexLock(&threadLock);
+    bool ret = threads.empty();
+    mutexUnlock(&threadLock);
+    return ret;
+}
+
+bool ui::threadProcMngr::backgroundEmpty()
+{
+    mutexLock(&bgThreadLock);
+    bool ret = bgThreads.empty();
+    mutexUnlock(&bgThreadLock);
+    return ret;
+}
+
+threadInfo *ui::threadProcMngr::newBackgroundThread(ThreadFunc func, void *args)
+{
+    threadInfo *t = new threadInfo;
+    t->status = new threadStatus;
+    t->running = false;
+    t->finished = false;
+    t->thrdFunc = func;
+    t->drawFunc = NULL;
+    t->argPtr = args;
+
+    if(R_FAILED(threadCreate(&t->thrd, t->thrdFunc, t, NULL, 0x80000, bgThreadPrio, -2)))
+    {
+        delete t->status;
+        delete t;
+        return NULL;
+    }
+
+    mutexLock(&bgThreadLock);
+    bgThreads.push_back(t);
+    mutexUnlock(&bgThreadLock);
+
+    t->running = true;
+    threadStart(&t->thrd);
+    return t;
+}
+
 void ui::threadProcMngr::update()
 {
     if(!threads.empty())
@@ -63,6 +117,26 @@ void ui::threadProcMngr::update()
     }
 }
 
+void ui::threadProcMngr::updateBackground()
+{
+    mutexLock(&bgThreadLock);
+    for(unsigned i = 0; i < bgThreads.size(); )
+    {
+        threadInfo *t = bgThreads[i];
+        if(t->finished)
+        {
+            threadWaitForExit(&t->thrd);
+            threadClose(&t->thrd);
+            delete t->status;
+            delete t;
+            bgThreads.erase(bgThreads.begin() + i);
+        }
+        else
+            ++i;
+    }
+    mutexUnlock(&bgThreadLock);
+}
+
 void ui::threadProcMngr::draw()
 {
     if(!threads.empty())
@@ -94,3 +168,32 @@ void ui::threadProcMngr::draw()
         }
     }
 }
+
+void ui::threadProcMngr::drawBackground()
+{
+    std::vector<std::string> statuses;
+    int lines = 0;
+    mutexLock(&bgThreadLock);
+    for(threadInfo *t : bgThreads)
+    {
+        std::string bgStatus;
+        t->status->getStatus(bgStatus);
+        //Transfers can report more than one line
+        while(!bgStatus.empty() && bgStatus.back() == '\n')
+            bgStatus.pop_back();
+        if(bgStatus.empty())
+            continue;
+
+        lines += 1 + std::count(bgStatus.begin(), bgStatus.end(), '\n');
+        statuses.push_back(bgStatus);
+    }
+    mutexUnlock(&bgThreadLock);
+
+    //Last line sits at the bottom margin and the rest stack up from it so none of it ends up off screen
+    int y = 656 - 14 * (lines - 1);
+    for(const std::string& bgStatus : statuses)
+    {
+        gfx::drawTextf(NULL, 12, 30, y, &ui::txtCont, bgStatus.c_str());
+        y += 14 * (1 + std::count(bgStatus.begin(), bgStatus.end(), '\n'));
+    }
+}
@@ -21,6 +21,17 @@ void ui::ttlRefresh()
     mutexUnlock(&ttlViewLock);
 }
 
+void ui::ttlRefresh(const std::vector<unsigned>& _users)
+{
+    mutexLock(&ttlViewLock);
+    for(unsigned u : _users)
+    {
+        if(u < ttlViews.size())
+            ttlViews[u]->refresh();
+    }
+    mutexUnlock(&ttlViewLock);
+}
+
 static void ttlViewCallback(void *a)
 {
     unsigned curUserIndex = data::getCurrentUserIndex();
@@ -146,6 +157,7 @@ static void ttlOptsDeleteAllBackups_t(void *a)
     for(unsigned i = 0; i < backupList->getCount(); i++)
     {
         std::string delPath = targetPath + backupList->getItem(i);
+        fs::remoteQueueRelease(delPath);
         if(backupList->isDir(i))
         {
             delPath += "/";
@@ -204,7 +216,7 @@ static void ttlOptsDeleteSaveData_t(void *a)
     t->status->setStatus(ui::getUICString("threadStatusDeletingSaveData", 0), title.c_str());
     if(R_SUCCEEDED(fsDeleteSaveDataFileSystemBySaveDataSpaceId((FsSaveDataSpaceId)d->saveInfo.save_data_space_id, d->saveInfo.save_data_id)))
     {
-        data::loadUsersTitles(false);
+        std::vector<unsigned> changed = data::removeSave(d->saveInfo.save_data_id);
         if(u->titleInfo.size() == 0)
         {
             //Kick back to user
@@ -215,7 +227,7 @@ static void ttlOptsDeleteSaveData_t(void *a)
             ui::changeState(USR_SEL);
         }
         ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("saveDataDeleteSuccess", 0), title.c_str());
-        ttlViews[userIndex]->refresh();
+        ui::ttlRefresh(changed);
     }
     t->finished = true;
 }
@@ -245,26 +257,26 @@ static void ttlOptsExtendSaveData(void *a)
 static void ttlOptsExportSVI(void *a)
 {
     data::userTitleInfo *ut = data::getCurrentUserTitleInfo();
-    data::titleInfo *t = data::getTitleInfoByTID(ut->tid);
     std::string out = fs::getWorkDir() + "svi/";
     fs::mkDir(out.substr(0, out.length() - 1));
     out += util::getIDStr(ut->tid) + ".svi";
-    FILE *svi = fopen(out.c_str(), "wb");
-    if(svi)
+
+    //Titles only keep the parts of the NACP they use, so the full one comes from ns with the icon
+    NsApplicationControlData *ctrlData = new NsApplicationControlData;
+    uint64_t ctrlSize = 0;
+    Result ctrlRes = nsGetApplicationControlData(NsApplicationControlSource_Storage, ut->tid, ctrlData, sizeof(NsApplicationControlData), &ctrlSize);
+    FILE *svi = NULL;
+    if(R_SUCCEEDED(ctrlRes) && ctrlSize > sizeof(ctrlData->nacp) && (svi = fopen(out.c_str(), "wb")))
     {
-        //Grab icon
-        NsApplicationControlData *ctrlData = new NsApplicationControlData;
-        uint64_t ctrlSize = 0;
-        nsGetApplicationControlData(NsApplicationControlSource_Storage, ut->tid, ctrlData, sizeof(NsApplicationControlData), &ctrlSize);
         size_t jpegSize = ctrlSize - sizeof(ctrlData->nacp);
 
         fwrite(&ut->tid, sizeof(uint64_t), 1, svi);
-        fwrite(&t->nacp, sizeof(NacpStruct), 1, svi);
+        fwrite(&ctrlData->nacp, sizeof(NacpStruct), 1, svi);
         fwrite(ctrlData->icon, 1, jpegSize, svi);
         fclose(svi);
-        delete ctrlData;
         ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popSVIExported", 0));
     }
+    delete ctrlData;
 }
 
 static void infoPanelDraw(void *a)
@@ -277,7 +289,7 @@ static void infoPanelDraw(void *a)
     rectWidth = width - 20;
 
     iconX = (width / 2) - 128;
-    gfx::texDraw(panel, data::getTitleIconByTID(d->tid), iconX, 24);
+    gfx::texDrawStretch(panel, data::getTitleIconByTID(d->tid), iconX, 24, 256, 256);
 
     gfx::drawRect(panel, &ui::rectLt, 10, drawY, rectWidth, 38);
     gfx::drawTextf(panel, 18, 20, drawY + 10, &ui::txtCont, data::getTitleNameByTID(d->tid).c_str());
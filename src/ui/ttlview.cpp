@@ -23,7 +23,7 @@ void ui::titleTile::draw(SDL_Texture *target, int x, int y, bool sel)
 
     int dX = x - ((wS - w) / 2);
     int dY = y - ((hS - h) / 2);
-    gfx::texDrawStretch(target, icon, dX, dY, wS, hS);
+    gfx::texDrawStretch(target, data::getTitleIconByTID(tid), dX, dY, wS, hS);
     if(fav)
         gfx::drawTextf(target, 20, dX + 8, dY + 8, &ui::heartColor, "♥");
 }
@@ -39,7 +39,7 @@ ui::titleview::titleview(const data::user& _u, int _iconW, int _iconH, int _horG
     u = &_u;
 
     for(const data::userTitleInfo& t : u->titleInfo)
-        tiles.emplace_back(new ui::titleTile(_iconW, _iconH, cfg::isFavorite(t.tid), data::getTitleIconByTID(t.tid)));
+        tiles.emplace_back(new ui::titleTile(_iconW, _iconH, cfg::isFavorite(t.tid), t.tid));
 }
 
 ui::titleview::~titleview()
@@ -50,12 +50,18 @@ ui::titleview::~titleview()
 
 void ui::titleview::refresh()
 {
+    //Keep the cursor on the same title if it's still there. Sorting can move it.
+    uint64_t selTID = selected >= 0 && selected < (int)tiles.size() ? tiles[selected]->getTID() : 0;
     for(ui::titleTile *t : tiles)
         delete t;
 
     tiles.clear();
     for(const data::userTitleInfo& t : u->titleInfo)
-        tiles.emplace_back(new ui::titleTile(iconW, iconH, cfg::isFavorite(t.tid), data::getTitleIconByTID(t.tid)));
+    {
+        if(selTID != 0 && t.tid == selTID)
+            selected = tiles.size();
+        tiles.emplace_back(new ui::titleTile(iconW, iconH, cfg::isFavorite(t.tid), t.tid));
+    }
 
     if(selected > (int)tiles.size() - 1 && selected > 0)
         selected = tiles.size() - 1;
@@ -163,7 +169,7 @@ void ui::titleview::draw(SDL_Texture *target)
                 selRectX = tX - 24;
                 selRectY = tY - 24;
             }
-            else
+            else if(tY + iconH > 0 && tY < tH)//Skip what's off screen so its icon isn't loaded
                 tiles[i]->draw(target, tX, tY, false);
         }
     }
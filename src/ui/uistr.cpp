@@ -133,6 +133,7 @@ void ui::initStrings()
     addUIString("confirmDeleteBackupsTitle", 0, "Are you sure you would like to delete all save backups for #%s#?");
     addUIString("confirmDeleteBackupsAll", 0, "Are you sure you would like to delete *all* of your save backups for all of your games?");
     addUIString("confirmDriveOverwrite", 0, "Downloading this backup from drive will overwrite the one on your SD card. Continue?");
+    addUIString("confirmDriveOverwriteAll", 0, "Download every remote backup for this title? Backups on your SD card with the same name will be overwritten.");
 
     //Save Data related strings
     addUIString("saveDataNoneFound", 0, "No saves found for #%s#!");
@@ -176,6 +177,7 @@ void ui::initStrings()
 
     //New folder pop menu strings
     addUIString("folderMenuNew", 0, "New Backup");
+    addUIString("folderMenuRemoteLoading", 0, "[R] Loading...");
 
     //File mode properties string
     addUIString("fileModeFileProperties", 0, "Path: %s\nSize: %s");
@@ -204,6 +206,7 @@ void ui::initStrings()
     addUIString("settingsMenu", 19, "Title Sorting Type: ");
     addUIString("settingsMenu", 20, "Animation Scale: ");
     addUIString("settingsMenu", 21, "Auto-upload to Drive/Webdav: ");
+    addUIString("settingsMenu", 22, "Remove Unused Remote Chunks");
 
     //Main menu
     addUIString("mainMenuSettings", 0, "Settings");
@@ -239,6 +242,7 @@ void ui::initStrings()
     addUIString("userOptions", 1, "Create Save Data");
     addUIString("userOptions", 2, "Create All Save Data");
     addUIString("userOptions", 3, "Delete All User Saves");
+    addUIString("userOptions", 4, "Upload All To Remote");
 
     //Title Options
     addUIString("titleOptions", 0, "Information");
@@ -272,6 +276,15 @@ void ui::initStrings()
     addUIString("threadStatusUploadingFile", 0, "Uploading #%s#...");
     addUIString("threadStatusDownloadingFile", 0, "Downloading #%s#...");
     addUIString("threadStatusCompressingSaveForUpload", 0, "Compressing #%s# for upload...");
+    addUIString("threadStatusSplittingChunks", 0, "Splitting #%s# into chunks...");
+    addUIString("threadStatusJoiningChunks", 0, "Putting #%s# back together...");
+    addUIString("threadStatusCollectingChunks", 0, "Looking for unused remote chunks...");
+    addUIString("threadStatusUploadQueue", 0, "Upload queue: %u left");
+    addUIString("threadStatusUploadQueueWaiting", 0, "Upload queue: %u waiting");
+    addUIString("threadStatusUploadQueueRetry", 0, "Upload failed. Retrying in %u seconds...");
+    addUIString("threadStatusLoadingRemote", 0, "Loading remote backups...");
+    addUIString("threadStatusScanningTrash", 0, "Checking trash bin size...");
+    addUIString("threadStatusPurgingTrash", 0, "Purging trash: #%s# (%u/%u)");
 
     //Random leftover pop-ups
     addUIString("popCPUBoostEnabled", 0, "CPU Boost Enabled for ZIP.");
@@ -284,10 +297,18 @@ void ui::initStrings()
     addUIString("popChangeOutputFolder", 0, "#%s# changed to #%s#");
     addUIString("popChangeOutputError", 0, "#%s# contains illegal or non-ASCII characters.");
     addUIString("popTrashEmptied", 0, "Trash emptied");
+    addUIString("popChunksRemoved", 0, "%u unused chunks removed.");
+    addUIString("popChunksNotRemoved", 0, "Couldn't read every manifest. No chunks were removed.");
     addUIString("popSVIExported", 0, "SVI Exported.");
     addUIString("popDriveStarted", 0, "Google Drive started successfully.");
     addUIString("popDriveFailed", 0, "Failed to start Google Drive.");
     addUIString("popRemoteNotActive", 0, "Remote is not available");
+    addUIString("popRemoteLoading", 0, "Remote backups are still loading");
+    addUIString("popRemoteTransfersFailed", 0, "%u of %u transfers failed. Check the log.");
+    addUIString("popRemoteDownloadFailed", 0, "Downloading #%s# failed. Try again to resume it.");
+    addUIString("popRemoteUploadFailed", 0, "Uploading #%s# failed. Check the log.");
+    addUIString("popRemoteUpToDate", 0, "#%s# is already up to date on the remote.");
+    addUIString("popRemoteSyncDone", 0, "%u uploaded, %u already up to date.");
     addUIString("popWebdavStarted", 0, "Webdav started successfully.");
     addUIString("popWebdavFailed", 0, "Failed to start Webdav.");
 
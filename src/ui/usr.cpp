@@ -36,22 +36,7 @@ static struct
 {
     bool operator()(const uint64_t& tid1, const uint64_t& tid2)
     {
-        std::string tid1Title = data::getTitleNameByTID(tid1);
-        std::string tid2Title = data::getTitleNameByTID(tid2);
-
-        uint32_t pointA = 0, pointB = 0;
-        for(unsigned i = 0, j = 0; i < tid1Title.length(); )
-        {
-            ssize_t tid1Cnt = decode_utf8(&pointA, (const uint8_t *)&tid1Title.c_str()[i]);
-            ssize_t tid2Cnt = decode_utf8(&pointB, (const uint8_t *)&tid2Title.c_str()[j]);
-
-            pointA = tolower(pointA), pointB = tolower(pointB);
-            if(pointA != pointB)
-                return pointA < pointB;
-
-            i += tid1Cnt, j += tid2Cnt;
-        }
-        return false;
+        return data::titles[tid1].sortKey < data::titles[tid2].sortKey;
     }
 } sortCreateTIDs;
 
@@ -166,16 +151,27 @@ static void usrOptDeleteAllUserSaves_t(void *a)
     int curUserIndex = data::getCurrentUserIndex();
     int devUser = ui::usrMenu->getOptPos(ui::getUICString("saveTypeMainMenu", 0));
 
+    std::vector<uint64_t> deleted;
     for(data::userTitleInfo& tinf : u->titleInfo)
     {
         if(tinf.saveInfo.save_data_type != FsSaveDataType_System && (tinf.saveInfo.save_data_type != FsSaveDataType_Device || curUserIndex == devUser))
         {
             t->status->setStatus(ui::getUICString("threadStatusDeletingSaveData", 0), data::getTitleNameByTID(tinf.tid).c_str());
-            fsDeleteSaveDataFileSystemBySaveDataSpaceId(FsSaveDataSpaceId_User, tinf.saveInfo.save_data_id);
+            if(R_SUCCEEDED(fsDeleteSaveDataFileSystemBySaveDataSpaceId(FsSaveDataSpaceId_User, tinf.saveInfo.save_data_id)))
+                deleted.push_back(tinf.saveInfo.save_data_id);
         }
     }
-    data::loadUsersTitles(false);
-    ui::ttlRefresh();
+
+    std::vector<unsigned> changed;
+    for(uint64_t& saveID : deleted)
+    {
+        for(unsigned user : data::removeSave(saveID))
+        {
+            if(std::find(changed.begin(), changed.end(), user) == changed.end())
+                changed.push_back(user);
+        }
+    }
+    ui::ttlRefresh(changed);
     t->finished = true;
 }
 
@@ -186,6 +182,14 @@ static void usrOptDeleteAllUserSaves(void *a)
     ui::confirm(conf);
 }
 
+static void usrOptRemoteSyncAll(void *a)
+{
+    if(fs::rfs)
+        ui::newThread(fs::remoteSyncAllTitles, NULL, NULL);
+    else
+        ui::showPopMessage(POP_FRAME_DEFAULT, ui::getUICString("popRemoteNotActive", 0));
+}
+
 static void usrOptPanelDraw(void *a)
 {
     SDL_Texture *panel = (SDL_Texture *)a;
@@ -304,7 +308,7 @@ static void initSaveCreateMenus()
     //Group into vectors to match
     for(auto& t : data::titles)
     {
-        NacpStruct *nacp = &t.second.nacp;
+        data::titleNacp *nacp = &t.second.nacp;
 
         if(nacp->user_account_save_data_size > 0)
             accSids.push_back(t.first);
@@ -399,7 +403,7 @@ void ui::usrInit()
     usrOptPanel = new ui::slideOutPanel(410, 720, 0, ui::SLD_RIGHT, usrOptPanelDraw);
     ui::registerPanel(usrOptPanel);
 
-    for(int i = 0; i < 4; i++)
+    for(int i = 0; i < 5; i++)
         usrOptMenu->addOpt(NULL, ui::getUIString("userOptions", i));
 
     //Dump All User Saves
@@ -410,6 +414,8 @@ void ui::usrInit()
     usrOptMenu->optAddButtonEvent(2, HidNpadButton_A, usrOptCreateAllSaves, NULL);
     //Delete All
     usrOptMenu->optAddButtonEvent(3, HidNpadButton_A, usrOptDeleteAllUserSaves, NULL);
+    //Upload everything that changed
+    usrOptMenu->optAddButtonEvent(4, HidNpadButton_A, usrOptRemoteSyncAll, NULL);
     usrOptMenu->setActive(false);
 
     saveCreatePanel = new ui::slideOutPanel(512, 720, 0, ui::SLD_RIGHT, saveCreatePanelDraw);
@@ -184,6 +184,22 @@ std::string util::safeString(const std::string& s)
     return ret;
 }
 
+std::u32string util::getSortKey(const std::string& s)
+{
+    std::u32string ret;
+    for(unsigned i = 0; i < s.length(); )
+    {
+        uint32_t tmpChr = 0;
+        ssize_t untCnt = decode_utf8(&tmpChr, (uint8_t *)&s.data()[i]);
+        if(untCnt <= 0)
+            break;
+
+        i += untCnt;
+        ret += (char32_t)tolower(tmpChr);
+    }
+    return ret;
+}
+
 static inline std::string getTimeString(const uint32_t& _h, const uint32_t& _m)
 {
     char tmp[32];
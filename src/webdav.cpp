@@ -1,29 +1,274 @@
+#include <stdio.h>
+#include <string_view>
+
 #include "webdav.h"
 #include "fs.h"
-#include "tinyxml2.h"
+
+#define UPLOAD_RECORD_PATH "sdmc:/config/JKSV/webdavUploads.txt"
+// Seconds a cached listing is trusted without asking the server
+#define LIST_CACHE_FRESH 30
+
+// Only ask for what RfsItem uses so the server doesn't send every property it has
+static const char *PROPFIND_BODY =
+    "<?xml version=\"1.0\" encoding=\"utf-8\"?>"
+    "<d:propfind xmlns:d=\"DAV:\" xmlns:cs=\"http://calendarserver.org/ns/\"><d:prop>"
+    "<d:displayname/><d:resourcetype/><d:getcontentlength/><d:getetag/><cs:getctag/>"
+    "</d:prop></d:propfind>";
+
+// Appends _in to _out with XML entities decoded
+static void appendDecoded(std::string& _out, std::string_view _in) {
+    size_t i = 0;
+    while(i < _in.size()) {
+        size_t amp = _in.find('&', i);
+        _out.append(_in.substr(i, amp == std::string_view::npos ? std::string_view::npos : amp - i));
+        if(amp == std::string_view::npos)
+            break;
+
+        size_t semi = _in.find(';', amp);
+        if(semi == std::string_view::npos) {
+            _out.append(_in.substr(amp));
+            break;
+        }
+
+        std::string_view entity = _in.substr(amp + 1, semi - amp - 1);
+        if(entity == "amp")
+            _out += '&';
+        else if(entity == "lt")
+            _out += '<';
+        else if(entity == "gt")
+            _out += '>';
+        else if(entity == "quot")
+            _out += '"';
+        else if(entity == "apos")
+            _out += '\'';
+        else if(entity.size() > 1 && entity[0] == '#') {
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            uint32_t c = strtoul(std::string(entity.substr(hex ? 2 : 1)).c_str(), NULL, hex ? 16 : 10);
+            // UTF-8 encode
+            if(c < 0x80) {
+                _out += (char)c;
+            } else if(c < 0x800) {
+                _out += (char)(0xC0 | (c >> 6));
+                _out += (char)(0x80 | (c & 0x3F));
+            } else if(c < 0x10000) {
+                _out += (char)(0xE0 | (c >> 12));
+                _out += (char)(0x80 | ((c >> 6) & 0x3F));
+                _out += (char)(0x80 | (c & 0x3F));
+            } else {
+                _out += (char)(0xF0 | (c >> 18));
+                _out += (char)(0x80 | ((c >> 12) & 0x3F));
+                _out += (char)(0x80 | ((c >> 6) & 0x3F));
+                _out += (char)(0x80 | (c & 0x3F));
+            }
+        } else {
+            _out.append(_in.substr(amp, semi - amp + 1));
+        }
+        i = semi + 1;
+    }
+}
+
+// Parses a PROPFIND multistatus as curl receives it instead of holding the whole body and a DOM of it.
+// Only what's left of an unfinished tag or text is carried between chunks, so memory doesn't grow with the listing.
+// Elements are matched by local name so it doesn't matter what prefix the server gives the DAV: namespace.
+class davStreamParser {
+public:
+    davStreamParser(rfs::WebDav *dav, const std::string& origin, bool includeSelf, std::vector<rfs::RfsItem> *items, std::string *version)
+        : dav(dav), origin(origin), includeSelf(includeSelf), items(items), version(version) {}
+
+    void feed(const char *data, size_t length) {
+        pending.append(data, length);
+
+        size_t pos = 0;
+        while(pos < pending.size()) {
+            if(pending[pos] != '<') {
+                size_t lt = pending.find('<', pos);
+                size_t end = lt == std::string::npos ? pending.size() : lt;
+                // Don't decode an entity that's been cut off by the end of the chunk
+                if(lt == std::string::npos) {
+                    size_t amp = pending.rfind('&');
+                    if(amp != std::string::npos && amp >= pos && pending.find(';', amp) == std::string::npos)
+                        end = amp;
+                }
+
+                if(capture)
+                    appendDecoded(text, std::string_view(pending).substr(pos, end - pos));
+
+                pos = end;
+                if(lt == std::string::npos)
+                    break;
+
+                continue;
+            }
+
+            size_t close;
+            if(pending.compare(pos, 4, "<!--") == 0) {
+                close = pending.find("-->", pos);
+                if(close == std::string::npos)
+                    break;
+
+                close += 2;
+            } else if(pending.compare(pos, 9, "<![CDATA[") == 0) {
+                close = pending.find("]]>", pos);
+                if(close == std::string::npos)
+                    break;
+
+                if(capture)
+                    text.append(pending, pos + 9, close - pos - 9);
+                close += 2;
+            } else {
+                close = pending.find('>', pos);
+                if(close == std::string::npos)
+                    break;
+
+                handleTag(std::string_view(pending).substr(pos + 1, close - pos - 1));
+            }
+            pos = close + 1;
+        }
+        pending.erase(0, pos);
+    }
+
+private:
+    rfs::WebDav *dav;
+    const std::string& origin;
+    bool includeSelf;
+    std::vector<rfs::RfsItem> *items;
+    std::string *version;
+
+    std::string pending, text, sizeText, ctagText, parentId;
+    // Where the text of the element being read goes. NULL if it isn't one that's used
+    std::string *capture = NULL;
+    bool inResponse = false, inResourceType = false, haveSelf = false;
+    rfs::RfsItem item;
+
+    void handleTag(std::string_view tag) {
+        if(tag.empty() || tag[0] == '?' || tag[0] == '!')
+            return;
+
+        bool closing = tag[0] == '/';
+        bool selfClosing = tag.back() == '/';
+        std::string_view name = tag.substr(closing ? 1 : 0);
+        name = name.substr(0, name.find_first_of(" \t\r\n/"));
+
+        size_t colon = name.rfind(':');
+        if(colon != std::string_view::npos)
+            name = name.substr(colon + 1);
+
+        if(closing) {
+            endElement(name);
+        } else {
+            startElement(name);
+            if(selfClosing)
+                endElement(name);
+        }
+    }
+
+    void startElement(std::string_view name) {
+        if(name == "response") {
+            inResponse = true;
+            item = rfs::RfsItem();
+            sizeText.clear();
+            ctagText.clear();
+            return;
+        }
+
+        if(!inResponse)
+            return;
+
+        if(name == "href")
+            capture = &item.id;
+        else if(name == "displayname")
+            capture = &item.name;
+        else if(name == "getcontentlength")
+            capture = &sizeText;
+        else if(name == "getetag")
+            capture = &item.etag;
+        else if(name == "getctag")
+            capture = &ctagText;
+        else if(name == "resourcetype")
+            inResourceType = true;
+        else if(name == "collection" && inResourceType)
+            item.isDir = true;
+
+        text.clear();
+    }
+
+    void endElement(std::string_view name) {
+        // Properties the server doesn't have come back empty in a 404 propstat. Those shouldn't overwrite anything.
+        if(capture) {
+            if(!text.empty())
+                *capture = text;
+            capture = NULL;
+        }
+
+        if(name == "resourcetype") {
+            inResourceType = false;
+        } else if(name == "response" && inResponse) {
+            inResponse = false;
+            finishItem();
+        }
+    }
+
+    void finishItem() {
+        // href can be absolute URI or relative reference. ALWAYS convert to relative reference
+        if(item.id.find(origin) == 0)
+            item.id = item.id.substr(origin.length());
+
+        if(item.name.empty())
+            item.name = dav->getDisplayNameFromURL(item.id);
+
+        if(!sizeText.empty())
+            item.size = strtoull(sizeText.c_str(), NULL, 10);
+
+        // first Item is always the resource the PROPFIND was sent to
+        if(!haveSelf) {
+            haveSelf = true;
+            if(version)
+                *version = ctagText;
+
+            if(!includeSelf) {
+                parentId = item.id;
+                return; // do not push parent to list (we are only interested in the children)
+            }
+        }
+
+        item.parent = parentId;
+        items->push_back(item);
+    }
+};
+
+static size_t writeDavStream(const char *buff, size_t sz, size_t cnt, void *u) {
+    davStreamParser *parser = (davStreamParser *)u;
+    parser->feed(buff, sz * cnt);
+    return sz * cnt;
+}
 
 rfs::WebDav::WebDav(const std::string& origin, const std::string& username, const std::string& password)
     : origin(origin), username(username), password(password)
 {
-    curl = curl_easy_init();
-    if (curl) {
-        curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
-        if (!username.empty())
-            curl_easy_setopt(curl, CURLOPT_USERNAME, username.c_str());
-
-        if (!password.empty())
-            curl_easy_setopt(curl, CURLOPT_PASSWORD, password.c_str());
-    }
+    loadUploadRecords();
 }
 
 rfs::WebDav::~WebDav() {
-    if (curl) {
-        curl_easy_cleanup(curl);
-    }
+}
+
+void rfs::WebDav::setupHandle(CURL* local_curl) {
+    curl_easy_setopt(local_curl, CURLOPT_USERAGENT, USER_AGENT);
+    if (!username.empty())
+        curl_easy_setopt(local_curl, CURLOPT_USERNAME, username.c_str());
+
+    if (!password.empty())
+        curl_easy_setopt(local_curl, CURLOPT_PASSWORD, password.c_str());
+}
+
+// Borrows a pooled handle so requests to the server reuse the same connection. Must be given back with curlFuncs::returnHandle.
+CURL* rfs::WebDav::getHandle() {
+    CURL* local_curl = curlFuncs::borrowHandle();
+    setupHandle(local_curl);
+    return local_curl;
 }
 
 bool rfs::WebDav::resourceExists(const std::string& id) {
-    CURL* local_curl = curl_easy_duphandle(curl);
+    CURL* local_curl = getHandle();
 
     // we expect id to be properly escaped and starting with a /
     std::string fullUrl = origin + id;
@@ -51,14 +296,120 @@ bool rfs::WebDav::resourceExists(const std::string& id) {
         fs::logWrite("WebDav: directory exists failed: %s\n", curl_easy_strerror(res));
     }
 
-    curl_easy_cleanup(local_curl);
+    curlFuncs::returnHandle(local_curl);
 
     return ret;
 }
 
+// One line per file: id, etag and sha256 separated by tabs
+void rfs::WebDav::loadUploadRecords() {
+    FILE *recordFile = fopen(UPLOAD_RECORD_PATH, "r");
+    if(!recordFile)
+        return;
+
+    char line[1024];
+    while(fgets(line, 1024, recordFile)) {
+        std::string lineStr = line;
+        size_t tab1 = lineStr.find('\t');
+        size_t tab2 = tab1 == std::string::npos ? std::string::npos : lineStr.find('\t', tab1 + 1);
+        if(tab2 == std::string::npos)
+            continue;
+
+        uploadRecord record;
+        record.etag = lineStr.substr(tab1 + 1, tab2 - tab1 - 1);
+        record.sha256 = lineStr.substr(tab2 + 1, 64);
+        uploadRecords[lineStr.substr(0, tab1)] = record;
+    }
+    fclose(recordFile);
+}
+
+void rfs::WebDav::saveUploadRecords() {
+    FILE *recordFile = fopen(UPLOAD_RECORD_PATH, "w");
+    if(!recordFile)
+        return;
+
+    for(auto& r : uploadRecords)
+        fprintf(recordFile, "%s\t%s\t%s\n", r.first.c_str(), r.second.etag.c_str(), r.second.sha256.c_str());
+    fclose(recordFile);
+}
+
+void rfs::WebDav::recordUpload(const std::string& id, const std::string& sha256) {
+    std::string etag = getEtag(id);
+
+    mutexLock(&recordLock);
+    if(etag.empty() || sha256.empty())
+        uploadRecords.erase(id);
+    else
+        uploadRecords[id] = { etag, sha256 };
+    saveUploadRecords();
+    mutexUnlock(&recordLock);
+}
+
+std::string rfs::WebDav::getEtag(const std::string& id) {
+    std::vector<RfsItem> items;
+    if(propfind(id, "0", true, items) != 207 || items.empty())
+        return "";
+
+    return items[0].etag;
+}
+
+long rfs::WebDav::propfind(const std::string& id, const char *depth, bool includeSelf, std::vector<RfsItem>& items, std::string *version) {
+    CURL* local_curl = getHandle();
+
+    // we expect id to be properly escaped
+    std::string fullUrl = origin + id;
+    std::string depthHeader = std::string("Depth: ") + depth;
+
+    struct curl_slist *headers = NULL;
+    headers = curl_slist_append(headers, depthHeader.c_str());
+    headers = curl_slist_append(headers, "Content-Type: application/xml; charset=utf-8");
+
+    davStreamParser parser(this, origin, includeSelf, &items, version);
+
+    curl_easy_setopt(local_curl, CURLOPT_URL, fullUrl.c_str());
+    curl_easy_setopt(local_curl, CURLOPT_CUSTOMREQUEST, "PROPFIND");
+    curl_easy_setopt(local_curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(local_curl, CURLOPT_POSTFIELDS, PROPFIND_BODY);
+    curl_easy_setopt(local_curl, CURLOPT_WRITEFUNCTION, writeDavStream);
+    curl_easy_setopt(local_curl, CURLOPT_WRITEDATA, &parser);
+
+    CURLcode res = curl_easy_perform(local_curl);
+
+    long response_code = 0;
+    if(res == CURLE_OK) {
+        curl_easy_getinfo(local_curl, CURLINFO_RESPONSE_CODE, &response_code);
+    } else {
+        fs::logWrite("WebDav: PROPFIND of %s failed: %s\n", id.c_str(), curl_easy_strerror(res));
+    }
+
+    // 207 Multi-Status is a successful response for PROPFIND. Anything else isn't a listing.
+    if(response_code != 207)
+        items.clear();
+
+    curl_slist_free_all(headers); // free the custom headers
+    curlFuncs::returnHandle(local_curl);
+    return response_code;
+}
+
+std::string rfs::WebDav::getChecksum(const std::string& fileID) {
+    mutexLock(&recordLock);
+    auto findRecord = uploadRecords.find(fileID);
+    uploadRecord record = findRecord != uploadRecords.end() ? findRecord->second : uploadRecord();
+    mutexUnlock(&recordLock);
+
+    if(record.etag.empty())
+        return "";
+
+    // Someone else changed the file since JKSV uploaded it
+    if(getEtag(fileID) != record.etag)
+        return "";
+
+    return record.sha256;
+}
+
 // parent ID can never be empty
 std::string rfs::WebDav::appendResourceToParentId(const std::string& resourceName, const std::string& parentId, bool isDir) {
-    char *escaped = curl_easy_escape(curl, resourceName.c_str(), 0);
+    char *escaped = curl_easy_escape(NULL, resourceName.c_str(), 0);
     // we always expect parent to be properly URL encoded.
     std::string ret = parentId + std::string(escaped) + (isDir ? "/" : "");
     curl_free(escaped);
@@ -68,7 +419,7 @@ std::string rfs::WebDav::appendResourceToParentId(const std::string& resourceNam
 
 
 bool rfs::WebDav::createDir(const std::string& dirName, const std::string& parentId) {
-    CURL* local_curl = curl_easy_duphandle(curl);
+    CURL* local_curl = getHandle();
 
     std::string urlPath = appendResourceToParentId(dirName, parentId, true);
     std::string fullUrl = origin + urlPath;
@@ -86,7 +437,8 @@ bool rfs::WebDav::createDir(const std::string& dirName, const std::string& paren
 
     bool ret = res == CURLE_OK;
 
-    curl_easy_cleanup(local_curl);
+    curlFuncs::returnHandle(local_curl);
+    invalidateListing(urlPath);
 
     return ret;
 }
@@ -96,59 +448,81 @@ void rfs::WebDav::uploadFile(const std::string& filename, const std::string& par
     std::string fileId = appendResourceToParentId(filename, parentId, false);
     updateFile(fileId, _upload);
 }
+// Hashes the file as it's read so it doesn't need to be read twice
+typedef struct {
+    curlFuncs::curlUpArgs *upload;
+    Sha256Context ctx;
+} hashedUpload;
+
+static size_t readDataFileHashed(char *buff, size_t sz, size_t cnt, void *u) {
+    hashedUpload *in = (hashedUpload *)u;
+    size_t ret = curlFuncs::readDataFile(buff, sz, cnt, in->upload);
+    sha256ContextUpdate(&in->ctx, buff, ret);
+    return ret;
+}
+
 void rfs::WebDav::updateFile(const std::string& _fileID, curlFuncs::curlUpArgs *_upload) {
     // for webdav, same as upload
-    CURL* local_curl = curl_easy_duphandle(curl);
+    CURL* local_curl = getHandle();
 
     std::string fullUrl = origin + _fileID;
 
+    hashedUpload hashed;
+    hashed.upload = _upload;
+    sha256ContextCreate(&hashed.ctx);
+
     curl_easy_setopt(local_curl, CURLOPT_URL, fullUrl.c_str());
     curl_easy_setopt(local_curl, CURLOPT_UPLOAD, 1L); // implicit PUT
-    curl_easy_setopt(local_curl, CURLOPT_READFUNCTION, curlFuncs::readDataFile);
-    curl_easy_setopt(local_curl, CURLOPT_READDATA, _upload);
+    curl_easy_setopt(local_curl, CURLOPT_READFUNCTION, readDataFileHashed);
+    curl_easy_setopt(local_curl, CURLOPT_READDATA, &hashed);
     curl_easy_setopt(local_curl, CURLOPT_UPLOAD_BUFFERSIZE, UPLOAD_BUFFER_SIZE);
     curl_easy_setopt(local_curl, CURLOPT_UPLOAD, 1);
 
 
     CURLcode res = curl_easy_perform(local_curl);
+    long response_code = 0;
+    curl_easy_getinfo(local_curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curlFuncs::returnHandle(local_curl); // Clean up the CURL handle
+    invalidateListing(_fileID);
+
     if(res != CURLE_OK) {
         fs::logWrite("WebDav: file upload failed: %s\n", curl_easy_strerror(res));
     }
-
-    curl_easy_cleanup(local_curl); // Clean up the CURL handle
+    else if(response_code < 300) {
+        recordUpload(_fileID, sha256ToString(&hashed.ctx));
+    }
 }
-void rfs::WebDav::downloadFile(const std::string& _fileID, curlFuncs::curlDlArgs *_download) {
-    //Downloading is threaded because it's too slow otherwise
-    dlWriteThreadStruct dlWrite;
-    dlWrite.cfa = _download;
-
-    Thread writeThread;
-    threadCreate(&writeThread, writeThread_t, &dlWrite, NULL, 0x8000, 0x2B, 2);
-
+bool rfs::WebDav::prepareUpload(CURL* local_curl, transferItem *item) {
+    std::string fileId = item->id.empty() ? appendResourceToParentId(item->name, item->parent, false) : item->id;
+    std::string fullUrl = origin + fileId;
 
-    CURL* local_curl = curl_easy_duphandle(curl);
-
-    std::string fullUrl = origin + _fileID;
+    setupHandle(local_curl);
     curl_easy_setopt(local_curl, CURLOPT_URL, fullUrl.c_str());
-    curl_easy_setopt(local_curl, CURLOPT_WRITEFUNCTION, writeDataBufferThreaded);
-    curl_easy_setopt(local_curl, CURLOPT_WRITEDATA, &dlWrite);
-    threadStart(&writeThread);
+    curl_easy_setopt(local_curl, CURLOPT_UPLOAD, 1L);
+    return true;
+}
 
-    CURLcode res = curl_easy_perform(local_curl);
+bool rfs::WebDav::prepareDownload(CURL* local_curl, transferItem *item) {
+    std::string fullUrl = origin + item->id;
 
-    // Copied from gd.cpp implementation.
-    // TODO: Not sure how a thread helps if this parent waits here.
-    threadWaitForExit(&writeThread);
-    threadClose(&writeThread);
+    setupHandle(local_curl);
+    curl_easy_setopt(local_curl, CURLOPT_URL, fullUrl.c_str());
+    return true;
+}
 
-    if(res != CURLE_OK) {
-        fs::logWrite("WebDav: file download failed: %s\n", curl_easy_strerror(res));
+void rfs::WebDav::finishTransfer(CURL* local_curl, transferItem *item, bool success) {
+    if(!success) {
+        fs::logWrite("WebDav: transfer of %s failed\n", item->name.c_str());
+    }
+    else if(item->type == TRANSFER_UPLOAD) {
+        std::string fileId = item->id.empty() ? appendResourceToParentId(item->name, item->parent, false) : item->id;
+        invalidateListing(fileId);
+        recordUpload(fileId, fileSha256(item->localPath));
     }
-
-    curl_easy_cleanup(local_curl);
 }
+
 void rfs::WebDav::deleteFile(const std::string& _fileID) {
-    CURL* local_curl = curl_easy_duphandle(curl);
+    CURL* local_curl = getHandle();
 
     std::string fullUrl = origin + _fileID;
     curl_easy_setopt(local_curl, CURLOPT_URL, fullUrl.c_str());
@@ -159,17 +533,39 @@ void rfs::WebDav::deleteFile(const std::string& _fileID) {
         fs::logWrite("WebDav: file deletion failed: %s\n", curl_easy_strerror(res));
     }
 
-    curl_easy_cleanup(local_curl);
+    curlFuncs::returnHandle(local_curl);
+    invalidateListing(_fileID);
 }
 
+// Existence comes from the parent's listing. Opening a title asks about its folder right before listing it, and the root listing is almost always cached.
 bool rfs::WebDav::dirExists(const std::string& dirName, const std::string& parentId) {
     std::string urlPath = getDirID(dirName, parentId);
-    return resourceExists(urlPath);
+    if(cachedListingHas(parentId, urlPath, true))
+        return true;
+
+    std::vector<RfsItem> parentList;
+    if(!getListing(parentId, parentList))
+        return resourceExists(urlPath);
+
+    for(const RfsItem& item : parentList) {
+        if(item.isDir && sameResource(item.id, urlPath))
+            return true;
+    }
+    return false;
 }
 
 bool rfs::WebDav::fileExists(const std::string& filename, const std::string& parentId) {
     std::string urlPath = appendResourceToParentId(filename, parentId, false);
-    return resourceExists(urlPath);
+
+    std::vector<RfsItem> parentList;
+    if(!getListing(parentId, parentList))
+        return resourceExists(urlPath);
+
+    for(const RfsItem& item : parentList) {
+        if(!item.isDir && sameResource(item.id, urlPath))
+            return true;
+    }
+    return false;
 }
 
 std::string rfs::WebDav::getFileID(const std::string& filename, const std::string& parentId) {
@@ -182,137 +578,106 @@ std::string rfs::WebDav::getDirID(const std::string& dirName, const std::string&
 
 std::vector<rfs::RfsItem> rfs::WebDav::getListWithParent(const std::string& _parentId) {
     std::vector<rfs::RfsItem> list;
+    // TODO: Filter for zip?
+    if(!getListing(_parentId, list))
+        fs::logWrite("WebDav: directory listing of %s failed\n", _parentId.c_str());
 
-    CURL* local_curl = curl_easy_duphandle(curl);
-
-    // we expect _resource to be properly escaped
-    std::string fullUrl = origin + _parentId;
-
-    struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Depth: 1");
-
-    std::string responseString;
-
-    curl_easy_setopt(local_curl, CURLOPT_URL, fullUrl.c_str());
-    curl_easy_setopt(local_curl, CURLOPT_CUSTOMREQUEST, "PROPFIND");
-    curl_easy_setopt(local_curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(local_curl, CURLOPT_WRITEFUNCTION, curlFuncs::writeDataString);
-    curl_easy_setopt(local_curl, CURLOPT_WRITEDATA, &responseString);
-
-    CURLcode res = curl_easy_perform(local_curl);
-
-    if(res == CURLE_OK) {
-        long response_code;
-        curl_easy_getinfo(local_curl, CURLINFO_RESPONSE_CODE, &response_code);
-        if(response_code == 207) { // 207 Multi-Status is a successful response for PROPFIND
-            fs::logWrite("WebDav: Response from WebDav. Parsing.\n");
-            std::vector<rfs::RfsItem> items = parseXMLResponse(responseString);
-
-            // insert into array
-            // TODO: Filter for zip?
-            list.insert(list.end(), items.begin(), items.end());
-        }
-    } else {
-        fs::logWrite("WebDav: directory listing failed: %s\n", curl_easy_strerror(res));
-    }
-
-    curl_slist_free_all(headers); // free the custom headers
-    curl_easy_cleanup(local_curl);
     return list;
 }
 
-// Helper
-std::string rfs::WebDav::getNamespacePrefix(tinyxml2::XMLElement* root, const std::string& nsURI) {
-    for(const tinyxml2::XMLAttribute* attr = root->FirstAttribute(); attr; attr = attr->Next()) {
-        std::string name = attr->Name();
-        std::string value = attr->Value();
-        if(value == nsURI) {
-            auto pos = name.find(':');
-            if(pos != std::string::npos) {
-                return name.substr(pos + 1);
-            } else {
-                return "";  // Default namespace (no prefix)
+bool rfs::WebDav::getListing(const std::string& parentId, std::vector<RfsItem>& items) {
+    mutexLock(&cacheLock);
+    auto findList = listCache.find(parentId);
+    bool haveCached = findList != listCache.end();
+    cachedListing cached = haveCached ? findList->second : cachedListing();
+    mutexUnlock(&cacheLock);
+
+    uint64_t now = armGetSystemTick();
+    if(haveCached) {
+        bool fresh = now - cached.checked < LIST_CACHE_FRESH * armGetSystemTickFreq();
+
+        // Only the collection itself comes back, so this is cheap no matter how much is in it. Without a ctag there's nothing to compare.
+        std::vector<RfsItem> self;
+        std::string version;
+        if(fresh || (!cached.version.empty() && propfind(parentId, "0", true, self, &version) == 207 && version == cached.version)) {
+            if(!fresh) {
+                mutexLock(&cacheLock);
+                auto touchList = listCache.find(parentId);
+                if(touchList != listCache.end())
+                    touchList->second.checked = now;
+                mutexUnlock(&cacheLock);
             }
+            items = cached.items;
+            return true;
         }
     }
-    return "";  // No namespace found
-}
-
-std::vector<rfs::RfsItem> rfs::WebDav::parseXMLResponse(const std::string& xml) {
-    std::vector<RfsItem> items;
-    tinyxml2::XMLDocument doc;
-
-    if(doc.Parse(xml.c_str()) != tinyxml2::XML_SUCCESS) {
-        fs::logWrite("WebDav: Failed to parse XML from Server\n");
-        return items;
-    }
-
-    // Get the root element
-    tinyxml2::XMLElement *root = doc.RootElement();
-    std::string nsPrefix = getNamespacePrefix(root, "DAV:");
-    nsPrefix = !nsPrefix.empty() ? nsPrefix + ":" : nsPrefix;  // Append colon if non-empty
-
-    fs::logWrite("WebDav: Parsing response, using prefix: %s\n", nsPrefix.c_str());
 
-    // Loop through the responses
-    tinyxml2::XMLElement* responseElem = root->FirstChildElement((nsPrefix + "response").c_str());
+    std::string version;
+    bool ret = propfind(parentId, "1", false, items, &version) == 207;
 
-    std::string parentId;
+    mutexLock(&cacheLock);
+    if(ret)
+        listCache[parentId] = { version, items, now };
+    else
+        listCache.erase(parentId);
+    mutexUnlock(&cacheLock);
 
-    while (responseElem) {
-        RfsItem item;
-        item.size = 0;
+    return ret;
+}
 
-        tinyxml2::XMLElement* hrefElem = responseElem->FirstChildElement((nsPrefix + "href").c_str());
-        if (hrefElem) {
-            std::string hrefText = hrefElem->GetText();
-            // href can be absolute URI or relative reference. ALWAYS convert to relative reference
-            if(hrefText.find(origin) == 0) {
-                hrefText = hrefText.substr(origin.length());
+bool rfs::WebDav::cachedListingHas(const std::string& parentId, const std::string& id, bool isDir) {
+    bool ret = false;
+    mutexLock(&cacheLock);
+    auto findList = listCache.find(parentId);
+    if(findList != listCache.end()) {
+        for(const RfsItem& item : findList->second.items) {
+            // A file and a folder can have the same name once the trailing / is ignored
+            if(item.isDir == isDir && sameResource(item.id, id)) {
+                ret = true;
+                break;
             }
-            item.id = hrefText;
-            item.parent = parentId;
         }
+    }
+    mutexUnlock(&cacheLock);
+    return ret;
+}
 
-        tinyxml2::XMLElement* propstatElem = responseElem->FirstChildElement((nsPrefix + "propstat").c_str());
-        if (propstatElem) {
-            tinyxml2::XMLElement* propElem = propstatElem->FirstChildElement((nsPrefix + "prop").c_str());
-            if (propElem) {
-                tinyxml2::XMLElement* displaynameElem = propElem->FirstChildElement((nsPrefix + "displayname").c_str());
-                if (displaynameElem) {
-                    item.name = displaynameElem->GetText();
-                } else {
-                    // Fallback to name from href
-                    item.name = getDisplayNameFromURL(item.id);
-                }
-
-                tinyxml2::XMLElement* resourcetypeElem = propElem->FirstChildElement((nsPrefix + "resourcetype").c_str());
-                if (resourcetypeElem) {
-                    item.isDir = resourcetypeElem->FirstChildElement((nsPrefix + "collection").c_str()) != nullptr;
-                }
-
-                tinyxml2::XMLElement* contentLengthElem = propElem->FirstChildElement((nsPrefix + "getcontentlength").c_str());
-                if (contentLengthElem) {
-                    const char* sizeStr = contentLengthElem->GetText();
-                    if (sizeStr) {
-                        item.size = std::stoi(sizeStr);
-                    }
-                }
-            }
-        }
+void rfs::WebDav::invalidateListing(const std::string& id) {
+    // Parent is everything up to the last / that isn't the trailing one
+    size_t slash = id.find_last_of('/', id.length() > 1 ? id.length() - 2 : 0);
+    if(slash == std::string::npos)
+        return;
+
+    // id might be an href from the server, escaped differently than the key
+    std::string parentId = id.substr(0, slash + 1);
+    mutexLock(&cacheLock);
+    for(auto list = listCache.begin(); list != listCache.end(); ) {
+        if(sameResource(list->first, parentId))
+            list = listCache.erase(list);
+        else
+            ++list;
+    }
+    mutexUnlock(&cacheLock);
+}
 
-        responseElem = responseElem->NextSiblingElement((nsPrefix + "response").c_str());
+// Servers don't always escape hrefs the same way curl does, so ids are compared decoded
+bool rfs::WebDav::sameResource(const std::string& idA, const std::string& idB) {
+    if(idA == idB)
+        return true;
 
-        // first Item is always the parent.
-        if (parentId.empty()) {
-            parentId = item.id;
-            continue; // do not push parent to list (we are only interested in the children)
-        }
+    int lengthA, lengthB;
+    char *decodedA = curl_easy_unescape(NULL, idA.c_str(), idA.length(), &lengthA);
+    char *decodedB = curl_easy_unescape(NULL, idB.c_str(), idB.length(), &lengthB);
+    std::string a(decodedA, lengthA), b(decodedB, lengthB);
+    curl_free(decodedA);
+    curl_free(decodedB);
 
-        items.push_back(item);
-    }
+    if(!a.empty() && a.back() == '/')
+        a.pop_back();
+    if(!b.empty() && b.back() == '/')
+        b.pop_back();
 
-    return items;
+    return a == b;
 }
 
 // Function to extract and URL decode the filename from the URL
@@ -329,7 +694,7 @@ std::string rfs::WebDav::getDisplayNameFromURL(const std::string &url) {
 
     // URL decode the filename
     int outlength;
-    char *decodedFilename = curl_easy_unescape(curl, encodedFilename.c_str(), encodedFilename.length(), &outlength);
+    char *decodedFilename = curl_easy_unescape(NULL, encodedFilename.c_str(), encodedFilename.length(), &outlength);
     std::string result(decodedFilename, outlength);
 
     // Free the memory allocated by curl_easy_unescape